@@ -26,85 +26,230 @@
 
 #pragma once
 
+#include <compare>
+#include <concepts>
 #include <iostream>
 #include <list>
+#include <vector>
 
+#include "paralelo.hpp"
+
+// Subarvores com altura a partir desta sao divididas entre as threads nos
+// percursos paralelos (uma AVL com altura 12 tem pelo menos 376 nos).
+constexpr int ABB_ALTURA_PARALELA = 12;
+
+// Estatisticas das operacoes, ativadas compilando com -DABB_ESTATISTICAS.
+// Sem a macro, ABB_CONTA/ABB_NIVEL/ABB_PROFUNDIDADE nao geram codigo.
+#ifdef ABB_ESTATISTICAS
+
+#include <atomic>
+
+enum AbbContador {
+    ABB_ROT_ESQ,      // rotacoes simples a esquerda (inclui as das duplas)
+    ABB_ROT_DIR,      // rotacoes simples a direita (inclui as das duplas)
+    ABB_ROT_ESQ_DIR,  // rotacoes duplas esquerda-direita
+    ABB_ROT_DIR_ESQ,  // rotacoes duplas direita-esquerda
+    ABB_COMPARACOES,  // comparacoes entre chaves na descida
+    ABB_ALOCACOES,    // nos criados
+    ABB_LIBERACOES,   // nos destruidos
+    ABB_NCONTADORES
+};
+
+// histograma da profundidade em que terminam as buscas de insere/remove
+constexpr int ABB_PROF_MAX = 64;
+
+inline std::atomic<long> abb_contadores[ABB_NCONTADORES];
+inline std::atomic<long> abb_histograma[ABB_PROF_MAX];
+inline thread_local int abb_nivel = 0;
+
+// copia dos contadores em um instante
+struct AbbEstatisticas {
+    long c[ABB_NCONTADORES];
+    long hist[ABB_PROF_MAX];
+};
+
+// conta o nivel da recursao enquanto estiver no escopo
+struct AbbNivel {
+    AbbNivel() { abb_nivel++; }
+    ~AbbNivel() { abb_nivel--; }
+};
+
+inline void abb_estat_profundidade(int prof)
+{
+    if(prof >= ABB_PROF_MAX)
+        prof = ABB_PROF_MAX - 1;
+    abb_histograma[prof].fetch_add(1, std::memory_order_relaxed);
+}
+
+inline AbbEstatisticas abb_estat_le()
+{
+    AbbEstatisticas e;
+    for(int i = 0; i < ABB_NCONTADORES; i++)
+        e.c[i] = abb_contadores[i].load(std::memory_order_relaxed);
+    for(int i = 0; i < ABB_PROF_MAX; i++)
+        e.hist[i] = abb_histograma[i].load(std::memory_order_relaxed);
+    return e;
+}
+
+// escreve em os o que aconteceu desde 'antes' (por padrao, desde o inicio)
+inline void abb_estat_mostra(std::ostream& os, const char* rotulo,
+                             const AbbEstatisticas& antes = {})
+{
+    AbbEstatisticas e = abb_estat_le();
+    long d[ABB_NCONTADORES];
+    for(int i = 0; i < ABB_NCONTADORES; i++)
+        d[i] = e.c[i] - antes.c[i];
+
+    long buscas = 0, soma = 0;
+    int max = 0;
+    for(int i = 0; i < ABB_PROF_MAX; i++){
+        long n = e.hist[i] - antes.hist[i];
+        buscas += n;
+        soma += n * i;
+        if(n > 0)
+            max = i;
+    }
+
+    os << "[abb " << rotulo << "]"
+       << " rot esq " << d[ABB_ROT_ESQ] << " dir " << d[ABB_ROT_DIR]
+       << " esq-dir " << d[ABB_ROT_ESQ_DIR] << " dir-esq " << d[ABB_ROT_DIR_ESQ]
+       << " | comparacoes " << d[ABB_COMPARACOES]
+       << " | nos +" << d[ABB_ALOCACOES] << " -" << d[ABB_LIBERACOES]
+       << " | prof max " << max << " media "
+       << (buscas ? (double)soma / buscas : 0.0) << " (" << buscas << " buscas)"
+       << std::endl;
+}
+
+#define ABB_CONTA(c) abb_contadores[c].fetch_add(1, std::memory_order_relaxed)
+#define ABB_NIVEL() AbbNivel abb_nivel_escopo
+#define ABB_PROFUNDIDADE() abb_estat_profundidade(abb_nivel)
+
+#else
+
+#define ABB_CONTA(c) ((void)0)
+#define ABB_NIVEL() ((void)0)
+#define ABB_PROFUNDIDADE() ((void)0)
+
+#endif
+
+// Comparacao de tres vias padrao: negativo se a vem antes de b, zero se sao
+// equivalentes e positivo se a vem depois. Usa operator<=> quando o tipo tem
+// (uma comparacao por nivel da arvore); senao, operator<.
 template<typename T>
+struct AbbCompara {
+    int operator()(const T& a, const T& b) const
+    {
+        if constexpr(std::three_way_comparable<T>)
+        {
+            auto c = a <=> b;
+            return (c < 0) ? -1 : (c > 0);
+        }
+        else
+            return (a < b) ? -1 : (b < a);
+    }
+};
+
+// No da arvore. C define a ordem das chaves; outros comparadores permitem
+// ordenar o mesmo dado por outro campo (posicao na tela, tempo de criacao,
+// ...), por exemplo:
+//
+//     struct PorX {
+//         int operator()(const Invader& a, const Invader& b) const {
+//             return (a.r.pos.x > b.r.pos.x) - (a.r.pos.x < b.r.pos.x);
+//         }
+//     };
+//     Abb<Invader, PorX>* formacao;
+template<typename T, typename C = AbbCompara<T>>
 struct Abb {
     T dado;
-    Abb<T>* esq;
-    Abb<T>* dir;
+    Abb<T, C>* esq;
+    Abb<T, C>* dir;
+    Abb<T, C>* pai;  // nullptr na raiz; usado por abb_insere_dica
     int altura;
 };
 
-template<typename T>
-bool abb_vazio(Abb<T>* no)
+template<typename T, typename C>
+bool abb_vazio(Abb<T, C>* no)
 {
     return (no == nullptr);
 }
 
-template<typename T>
-int abb_altura(Abb<T>* no)
+template<typename T, typename C>
+int abb_altura(Abb<T, C>* no)
 {
     if(no == nullptr)
         return 0;
     return no->altura;
 }
 
-template<typename T>
-int abb_get_fb(Abb<T>* no)
+template<typename T, typename C>
+int abb_get_fb(Abb<T, C>* no)
 {
     if(no == nullptr)
         return 0;
     return (abb_altura(no->esq) - abb_altura(no->dir));
 }
 
-template<typename T>
-Abb<T>* abb_esq_rotate(Abb<T>* x)
+template<typename T, typename C>
+Abb<T, C>* abb_esq_rotate(Abb<T, C>* x)
 {
-    Abb<T>* y = x->dir;
-    Abb<T>* T2 = y->esq;
+    ABB_CONTA(ABB_ROT_ESQ);
+    Abb<T, C>* y = x->dir;
+    Abb<T, C>* T2 = y->esq;
 
     y->esq = x;
     x->dir = T2;
 
+    y->pai = x->pai;
+    x->pai = y;
+    if(T2 != nullptr)
+        T2->pai = x;
+
     x->altura = 1 + std::max(abb_altura(x->esq), abb_altura(x->dir));
     y->altura = 1 + std::max(abb_altura(y->esq), abb_altura(y->dir));
 
     return y;
 }
 
-template<typename T>
-Abb<T>* abb_dir_rotate(Abb<T>* x)
+template<typename T, typename C>
+Abb<T, C>* abb_dir_rotate(Abb<T, C>* x)
 {
-    Abb<T>* y = x->esq;
-    Abb<T>* T2 = y->dir;
+    ABB_CONTA(ABB_ROT_DIR);
+    Abb<T, C>* y = x->esq;
+    Abb<T, C>* T2 = y->dir;
 
     y->dir = x;
     x->esq = T2;
 
+    y->pai = x->pai;
+    x->pai = y;
+    if(T2 != nullptr)
+        T2->pai = x;
+
     x->altura = 1 + std::max(abb_altura(x->esq), abb_altura(x->dir));
     y->altura = 1 + std::max(abb_altura(y->esq), abb_altura(y->dir));
 
     return y;
 }
 
-template<typename T>
-Abb<T>* abb_inicia(T v)
+template<typename T, typename C = AbbCompara<T>>
+Abb<T, C>* abb_inicia(T v)
 {
-    Abb<T>* no = new Abb<T>;
+    ABB_CONTA(ABB_ALOCACOES);
+    Abb<T, C>* no = new Abb<T, C>;
     no->dado = v;
     no->altura = 1;
     no->esq = nullptr;
     no->dir = nullptr;
+    no->pai = nullptr;
 
     return no;
 }
 
-template<typename T>
-Abb<T>* abb_inicia(std::list<T>& entrada)
+template<typename T, typename C = AbbCompara<T>>
+Abb<T, C>* abb_inicia(std::list<T>& entrada)
 {
-    Abb<T>* no = nullptr;
+    Abb<T, C>* no = nullptr;
     if(entrada.empty() == true)
         return nullptr;
 
@@ -114,37 +259,56 @@ Abb<T>* abb_inicia(std::list<T>& entrada)
     return no;
 }
 
-template<typename T>
-Abb<T>* abb_insere(Abb<T>* no, T v)
+template<typename T, typename C>
+Abb<T, C>* abb_insere(Abb<T, C>* no, T v)
 {
+    ABB_NIVEL();
     if(no == nullptr)
-        return abb_inicia(v);
+    {
+        ABB_PROFUNDIDADE();
+        return abb_inicia<T, C>(v);
+    }
 
-    if(v < no->dado)
+    ABB_CONTA(ABB_COMPARACOES);
+    int c = C()(v, no->dado);
+    if(c < 0)
+    {
         no->esq = abb_insere(no->esq, v);
-    else if(v > no->dado)
+        no->esq->pai = no;
+    }
+    else if(c > 0)
+    {
         no->dir = abb_insere(no->dir, v);
+        no->dir->pai = no;
+    }
     else
+    {
+        ABB_PROFUNDIDADE();
         return no;
+    }
 
     no->altura = 1 + std::max(abb_altura(no->esq), abb_altura(no->dir));
 
     int fb = abb_get_fb(no);
 
-    if(fb > 1 && v < no->esq->dado)
+    // o filho onde v entrou esta pendendo para o lado de v, entao o fator
+    // dele decide entre rotacao simples e dupla, sem comparar chaves
+    if(fb > 1 && abb_get_fb(no->esq) > 0)
         return abb_dir_rotate(no);
 
-    if(fb < -1 && v > no->dir->dado)
+    if(fb < -1 && abb_get_fb(no->dir) < 0)
         return abb_esq_rotate(no);
 
-    if(fb > 1 && v > no->esq->dado)
+    if(fb > 1 && abb_get_fb(no->esq) < 0)
     {
+        ABB_CONTA(ABB_ROT_ESQ_DIR);
         no->esq = abb_esq_rotate(no->esq);
         return abb_dir_rotate(no);
     }
 
-    if(fb < -1 && v < no->dir->dado)
+    if(fb < -1 && abb_get_fb(no->dir) > 0)
     {
+        ABB_CONTA(ABB_ROT_DIR_ESQ);
         no->dir = abb_dir_rotate(no->dir);
         return abb_esq_rotate(no);
     }
@@ -152,42 +316,180 @@ Abb<T>* abb_insere(Abb<T>* no, T v)
     return no;
 }
 
-template<typename T>
-Abb<T>* abb_no_minimo(Abb<T>* no)
+// refaz alturas e balanceamento subindo a partir do pai de um no recem
+// inserido. Na insercao basta uma rotacao (simples ou dupla), e a subida
+// para assim que a altura de uma subarvore nao muda.
+template<typename T, typename C>
+Abb<T, C>* abb_rebalanceia_insercao(Abb<T, C>* raiz, Abb<T, C>* no)
+{
+    while(no != nullptr)
+    {
+        int h = no->altura;
+        Abb<T, C>* pai = no->pai;
+        Abb<T, C>* sub = no;
+
+        no->altura = 1 + std::max(abb_altura(no->esq), abb_altura(no->dir));
+        int fb = abb_get_fb(no);
+        if(fb > 1)
+        {
+            if(abb_get_fb(no->esq) < 0)
+            {
+                ABB_CONTA(ABB_ROT_ESQ_DIR);
+                no->esq = abb_esq_rotate(no->esq);
+            }
+            sub = abb_dir_rotate(no);
+        }
+        else if(fb < -1)
+        {
+            if(abb_get_fb(no->dir) > 0)
+            {
+                ABB_CONTA(ABB_ROT_DIR_ESQ);
+                no->dir = abb_dir_rotate(no->dir);
+            }
+            sub = abb_esq_rotate(no);
+        }
+
+        if(pai == nullptr)
+            return sub;
+        if(pai->esq == no)
+            pai->esq = sub;
+        else
+            pai->dir = sub;
+        if(sub->altura == h)
+            return raiz;
+        no = pai;
+    }
+    return raiz;
+}
+
+// Insere v comecando a busca perto do no dica (que deve estar na arvore
+// raiz), em vez de descer desde a raiz. Sobe da dica so ate o primeiro
+// ancestral cuja subarvore pode conter v e desce dali; para valores
+// proximos da dica o custo e O(1) amortizado. Retorna a nova raiz.
+template<typename T, typename C>
+Abb<T, C>* abb_insere_dica(Abb<T, C>* raiz, Abb<T, C>* dica, T v)
+{
+    if(raiz == nullptr)
+        return abb_inicia<T, C>(v);
+    if(dica == nullptr)
+        dica = raiz;
+
+    ABB_CONTA(ABB_COMPARACOES);
+    int c = C()(v, dica->dado);
+    if(c == 0)
+        return raiz;
+    bool menor = c < 0;
+
+    // Se v < dica, todo ancestral ja tem limite superior maior que v; falta
+    // achar o limite inferior, que e o pai na primeira aresta "a direita"
+    // da subida. O caso v > dica e simetrico.
+    Abb<T, C>* x = dica;
+    Abb<T, C>* sub = dica;
+    while(x->pai != nullptr)
+    {
+        Abb<T, C>* p = x->pai;
+        if(menor ? (x == p->dir) : (x == p->esq))
+        {
+            ABB_CONTA(ABB_COMPARACOES);
+            c = C()(v, p->dado);
+            if(menor ? (c > 0) : (c < 0))
+                break;
+            if(c == 0)
+                return raiz;
+            sub = p;
+        }
+        x = p;
+    }
+
+    // desce a partir de sub como em uma insercao comum
+    x = sub;
+    for(;;)
+    {
+        ABB_CONTA(ABB_COMPARACOES);
+        c = C()(v, x->dado);
+        if(c == 0)
+            return raiz;
+        Abb<T, C>** filho = (c < 0) ? &x->esq : &x->dir;
+        if(*filho == nullptr)
+        {
+            *filho = abb_inicia<T, C>(v);
+            (*filho)->pai = x;
+            return abb_rebalanceia_insercao(raiz, x);
+        }
+        x = *filho;
+    }
+}
+
+// retorna o no com dado igual a v, ou nullptr
+template<typename T, typename C>
+Abb<T, C>* abb_busca(Abb<T, C>* no, const T& v)
+{
+    while(no != nullptr)
+    {
+        int c = C()(v, no->dado);
+        if(c < 0)
+            no = no->esq;
+        else if(c > 0)
+            no = no->dir;
+        else
+            return no;
+    }
+    return nullptr;
+}
+
+template<typename T, typename C>
+Abb<T, C>* abb_no_minimo(Abb<T, C>* no)
 {
-    Abb<T>* curr = no;
+    Abb<T, C>* curr = no;
     while(curr->esq != nullptr)
         curr = curr->esq;
     return curr;
 }
 
-template<typename T>
-Abb<T>* abb_remove(Abb<T>* no, T v)
+template<typename T, typename C>
+Abb<T, C>* abb_remove(Abb<T, C>* no, T v)
 {
+    ABB_NIVEL();
     if(no == nullptr)
+    {
+        ABB_PROFUNDIDADE();
         return no;
+    }
 
-    if(v < no->dado)
+    ABB_CONTA(ABB_COMPARACOES);
+    int c = C()(v, no->dado);
+    if(c < 0)
         no->esq = abb_remove(no->esq, v);
-    else if(v > no->dado)
+    else if(c > 0)
         no->dir = abb_remove(no->dir, v);
     else
     {
+        ABB_PROFUNDIDADE();
         if((no->esq == nullptr) || (no->dir == nullptr))
         {
-            Abb<T>* temp = no->esq ? no->esq : no->dir;
+            Abb<T, C>* temp = no->esq ? no->esq : no->dir;
             if(temp == nullptr)
             {
                 temp = no;
                 no = nullptr;
             }
             else
+            {
+                // o filho toma o lugar do no, mantendo o pai deste
+                Abb<T, C>* pai = no->pai;
                 *no = *temp;
+                no->pai = pai;
+                if(no->esq != nullptr)
+                    no->esq->pai = no;
+                if(no->dir != nullptr)
+                    no->dir->pai = no;
+            }
+            ABB_CONTA(ABB_LIBERACOES);
             delete temp;
         }
         else
         {
-            Abb<T>* min = abb_no_minimo(no->dir);
+            Abb<T, C>* min = abb_no_minimo(no->dir);
             no->dado = min->dado;
             no->dir = abb_remove(no->dir, min->dado);
         }
@@ -205,6 +507,7 @@ Abb<T>* abb_remove(Abb<T>* no, T v)
 
     if(fb > 1 && abb_get_fb(no->esq) < 0)
     {
+        ABB_CONTA(ABB_ROT_ESQ_DIR);
         no->esq = abb_esq_rotate(no->esq);
         return abb_dir_rotate(no);
     }
@@ -214,6 +517,7 @@ Abb<T>* abb_remove(Abb<T>* no, T v)
 
     if(fb < -1 && abb_get_fb(no->dir) > 0)
     {
+        ABB_CONTA(ABB_ROT_DIR_ESQ);
         no->dir = abb_dir_rotate(no->dir);
         return abb_esq_rotate(no);
     }
@@ -221,8 +525,8 @@ Abb<T>* abb_remove(Abb<T>* no, T v)
     return no;
 }
 
-template<typename T>
-void abb_emOrdem(Abb<T>* a)
+template<typename T, typename C>
+void abb_emOrdem(Abb<T, C>* a)
 {
     if(a != nullptr)
     {
@@ -232,8 +536,8 @@ void abb_emOrdem(Abb<T>* a)
     }
 }
 
-template<typename T>
-void abb_preOrdem(Abb<T>* a, std::list<T>& saida)
+template<typename T, typename C>
+void abb_preOrdem(Abb<T, C>* a, std::list<T>& saida)
 {
     if(!abb_vazio(a))
     {
@@ -243,17 +547,96 @@ void abb_preOrdem(Abb<T>* a, std::list<T>& saida)
     }
 }
 
-template<typename T>
-void abb_destroi(Abb<T>* a)
+template<typename T, typename C>
+void abb_destroi(Abb<T, C>* a)
 {
     if(a != nullptr)
     {
         abb_destroi(a->esq);
         abb_destroi(a->dir);
+        ABB_CONTA(ABB_LIBERACOES);
         delete a;
     }
 }
 
+// aplica f a cada dado da arvore, em ordem
+template<typename T, typename C, typename F>
+void abb_percorre(Abb<T, C>* a, F&& f)
+{
+    if(a != nullptr)
+    {
+        abb_percorre(a->esq, f);
+        f(a->dado);
+        abb_percorre(a->dir, f);
+    }
+}
+
+// aplica f a cada dado da arvore, dividindo as subarvores grandes entre as
+// threads do pool; a ordem das chamadas nao e definida
+template<typename T, typename C, typename F>
+void abb_percorre_paralelo(Abb<T, C>* a, F&& f, paralelo::Pool& pool)
+{
+    if(a == nullptr)
+        return;
+    if(a->altura < ABB_ALTURA_PARALELA)
+    {
+        abb_percorre(a, f);
+        return;
+    }
+    f(a->dado);
+    pool.divide([&] { abb_percorre_paralelo(a->esq, f, pool); },
+                [&] { abb_percorre_paralelo(a->dir, f, pool); });
+}
+
+template<typename T, typename C>
+void abb_destroi_paralelo(Abb<T, C>* a, paralelo::Pool& pool)
+{
+    if(a == nullptr)
+        return;
+    if(a->altura < ABB_ALTURA_PARALELA)
+    {
+        abb_destroi(a);
+        return;
+    }
+    pool.divide([&] { abb_destroi_paralelo(a->esq, pool); },
+                [&] { abb_destroi_paralelo(a->dir, pool); });
+    ABB_CONTA(ABB_LIBERACOES);
+    delete a;
+}
+
+template<typename T, typename C>
+Abb<T, C>* abb_inicia_ordenado(const std::vector<T>& v, int ini, int fim,
+                            paralelo::Pool& pool)
+{
+    if(ini >= fim)
+        return nullptr;
+
+    int meio = ini + (fim - ini) / 2;
+    Abb<T, C>* no = abb_inicia<T, C>(v[meio]);
+    // 2^ABB_ALTURA_PARALELA elementos formam uma arvore daquela altura
+    if(fim - ini >= (1 << ABB_ALTURA_PARALELA))
+        pool.divide([&] { no->esq = abb_inicia_ordenado<T, C>(v, ini, meio, pool); },
+                    [&] { no->dir = abb_inicia_ordenado<T, C>(v, meio + 1, fim, pool); });
+    else
+    {
+        no->esq = abb_inicia_ordenado<T, C>(v, ini, meio, pool);
+        no->dir = abb_inicia_ordenado<T, C>(v, meio + 1, fim, pool);
+    }
+    if(no->esq != nullptr)
+        no->esq->pai = no;
+    if(no->dir != nullptr)
+        no->dir->pai = no;
+    no->altura = 1 + std::max(abb_altura(no->esq), abb_altura(no->dir));
+    return no;
+}
+
+// constroi de uma vez uma arvore perfeitamente balanceada a partir de
+// valores ordenados e sem repeticao, em paralelo
+template<typename T, typename C = AbbCompara<T>>
+Abb<T, C>* abb_inicia_ordenado(const std::vector<T>& ordenados, paralelo::Pool& pool)
+{
+    return abb_inicia_ordenado<T, C>(ordenados, 0, (int)ordenados.size(), pool);
+}
 
 /* Exemplo abaixo de uma main para o código de arvore
 
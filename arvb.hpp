@@ -0,0 +1,437 @@
+// arvb.hpp
+// Implementacao de uma arvore B generica, com nos do tamanho de uma linha de
+// cache e busca das chaves dentro do no por instrucoes SIMD (SSE2/AVX2).
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2023 João Vicente Ferreira Lima, UFSM
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <cassert>
+#include <climits>
+#include <iostream>
+#include <list>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// Grau minimo da arvore B. Cada no guarda entre ARVB_ORDEM-1 e 2*ARVB_ORDEM-1
+// chaves; com 8 o vetor de chaves (16 ints) ocupa exatamente 64 bytes, uma
+// linha de cache.
+constexpr int ARVB_ORDEM = 8;
+constexpr int ARVB_MAX = 2 * ARVB_ORDEM - 1;
+constexpr int ARVB_LARG = 2 * ARVB_ORDEM;
+
+// Extrai a chave inteira de um dado. Tipos que nao sao inteiros devem
+// especializar esta estrutura (ver Invader em invaders.cpp). INT_MAX e
+// reservado para as posicoes livres dos nos: a chave tem que ser menor
+// (inicia, insere, busca e remove conferem com assert).
+template<typename T>
+struct arvb_chave {
+    int operator()(const T& v) const { return v; }
+};
+
+// So as chaves cabem em uma linha de cache, alinhada no inicio do no: a
+// busca em um nivel le essa linha e depois o ponteiro filhos[i], que fica
+// em outra. O no inteiro (filhos e dados) ocupa varias linhas; separar
+// filhos e dados em outro bloco so acrescentaria um acesso por nivel.
+template<typename T>
+struct ArvB {
+    alignas(64) int chaves[ARVB_LARG]; // posicoes livres valem INT_MAX
+    int n;                             // numero de chaves no no
+    bool folha;
+    ArvB<T>* filhos[ARVB_LARG];
+    T dados[ARVB_MAX];
+};
+
+// retorna quantas chaves do no sao menores que k, isto e, a posicao onde
+// k esta ou deveria estar. As posicoes livres valem INT_MAX, entao as 16
+// comparacoes podem ser feitas de uma vez sem olhar para n.
+inline int arvb_posicao(const int* chaves, int k)
+{
+#if defined(__AVX2__)
+    const __m256i vk = _mm256_set1_epi32(k);
+    const __m256i c0 = _mm256_load_si256((const __m256i*)chaves);
+    const __m256i c1 = _mm256_load_si256((const __m256i*)(chaves + 8));
+    unsigned m0 = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(vk, c0)));
+    unsigned m1 = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(vk, c1)));
+    return __builtin_popcount(m0 | (m1 << 8));
+#elif defined(__SSE2__)
+    const __m128i vk = _mm_set1_epi32(k);
+    unsigned m = 0;
+    for(int i = 0; i < ARVB_LARG; i += 4){
+        __m128i c = _mm_load_si128((const __m128i*)(chaves + i));
+        m |= _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(vk, c))) << i;
+    }
+    return __builtin_popcount(m);
+#else
+    int i = 0;
+    while(chaves[i] < k)
+        i++;
+    return i;
+#endif
+}
+
+template<typename T>
+bool arvb_vazio(ArvB<T>* no)
+{
+    return (no == nullptr);
+}
+
+template<typename T>
+ArvB<T>* arvb_novo_no(bool folha)
+{
+    ArvB<T>* no = new ArvB<T>;
+    for(int i = 0; i < ARVB_LARG; i++){
+        no->chaves[i] = INT_MAX;
+        no->filhos[i] = nullptr;
+    }
+    no->n = 0;
+    no->folha = folha;
+    return no;
+}
+
+template<typename T>
+ArvB<T>* arvb_inicia(T v)
+{
+    ArvB<T>* no = arvb_novo_no<T>(true);
+    no->chaves[0] = arvb_chave<T>()(v);
+    assert(no->chaves[0] != INT_MAX);
+    no->dados[0] = v;
+    no->n = 1;
+    return no;
+}
+
+// numero de niveis da arvore (todas as folhas estao no mesmo nivel)
+template<typename T>
+int arvb_altura(ArvB<T>* no)
+{
+    int h = 0;
+    for(; no != nullptr; no = no->filhos[0])
+        h++;
+    return h;
+}
+
+// retorna o dado com a mesma chave de v, ou nullptr se nao existir
+template<typename T>
+T* arvb_busca(ArvB<T>* no, const T& v)
+{
+    int k = arvb_chave<T>()(v);
+    assert(k != INT_MAX);
+    while(no != nullptr){
+        int i = arvb_posicao(no->chaves, k);
+        if(i < no->n && no->chaves[i] == k)
+            return &no->dados[i];
+        no = no->filhos[i];
+    }
+    return nullptr;
+}
+
+// divide o filho i de x, que esta cheio, subindo a chave do meio para x
+template<typename T>
+void arvb_divide_filho(ArvB<T>* x, int i)
+{
+    ArvB<T>* y = x->filhos[i];
+    ArvB<T>* z = arvb_novo_no<T>(y->folha);
+    const int t = ARVB_ORDEM;
+
+    z->n = t - 1;
+    for(int j = 0; j < t - 1; j++){
+        z->chaves[j] = y->chaves[j + t];
+        z->dados[j] = y->dados[j + t];
+        y->chaves[j + t] = INT_MAX;
+    }
+    if(!y->folha){
+        for(int j = 0; j < t; j++){
+            z->filhos[j] = y->filhos[j + t];
+            y->filhos[j + t] = nullptr;
+        }
+    }
+
+    for(int j = x->n; j > i; j--)
+        x->filhos[j + 1] = x->filhos[j];
+    x->filhos[i + 1] = z;
+    for(int j = x->n - 1; j >= i; j--){
+        x->chaves[j + 1] = x->chaves[j];
+        x->dados[j + 1] = x->dados[j];
+    }
+    x->chaves[i] = y->chaves[t - 1];
+    x->dados[i] = y->dados[t - 1];
+    y->chaves[t - 1] = INT_MAX;
+    y->n = t - 1;
+    x->n++;
+}
+
+template<typename T>
+ArvB<T>* arvb_insere(ArvB<T>* raiz, T v)
+{
+    if(raiz == nullptr)
+        return arvb_inicia(v);
+
+    int k = arvb_chave<T>()(v);
+    assert(k != INT_MAX);
+    if(raiz->n == ARVB_MAX){
+        ArvB<T>* s = arvb_novo_no<T>(false);
+        s->filhos[0] = raiz;
+        arvb_divide_filho(s, 0);
+        raiz = s;
+    }
+
+    // desce dividindo os nos cheios, entao sempre ha espaco na folha
+    ArvB<T>* x = raiz;
+    for(;;){
+        int i = arvb_posicao(x->chaves, k);
+        if(i < x->n && x->chaves[i] == k)
+            return raiz;
+        if(x->folha){
+            for(int j = x->n - 1; j >= i; j--){
+                x->chaves[j + 1] = x->chaves[j];
+                x->dados[j + 1] = x->dados[j];
+            }
+            x->chaves[i] = k;
+            x->dados[i] = v;
+            x->n++;
+            return raiz;
+        }
+        if(x->filhos[i]->n == ARVB_MAX){
+            arvb_divide_filho(x, i);
+            if(k == x->chaves[i])
+                return raiz;
+            if(k > x->chaves[i])
+                i++;
+        }
+        x = x->filhos[i];
+    }
+}
+
+template<typename T>
+ArvB<T>* arvb_inicia(std::list<T>& entrada)
+{
+    ArvB<T>* no = nullptr;
+    for(auto it = entrada.begin(); it != entrada.end(); it++)
+        no = arvb_insere(no, *it);
+    return no;
+}
+
+// junta o filho i+1 de x no filho i, descendo a chave i de x entre eles
+template<typename T>
+void arvb_junta(ArvB<T>* x, int i)
+{
+    ArvB<T>* y = x->filhos[i];
+    ArvB<T>* z = x->filhos[i + 1];
+
+    y->chaves[y->n] = x->chaves[i];
+    y->dados[y->n] = x->dados[i];
+    for(int j = 0; j < z->n; j++){
+        y->chaves[y->n + 1 + j] = z->chaves[j];
+        y->dados[y->n + 1 + j] = z->dados[j];
+    }
+    if(!y->folha){
+        for(int j = 0; j <= z->n; j++)
+            y->filhos[y->n + 1 + j] = z->filhos[j];
+    }
+    y->n += z->n + 1;
+
+    for(int j = i; j < x->n - 1; j++){
+        x->chaves[j] = x->chaves[j + 1];
+        x->dados[j] = x->dados[j + 1];
+        x->filhos[j + 1] = x->filhos[j + 2];
+    }
+    x->n--;
+    x->chaves[x->n] = INT_MAX;
+    x->filhos[x->n + 1] = nullptr;
+    delete z;
+}
+
+// passa uma chave do irmao esquerdo (i-1) para o filho i, via x
+template<typename T>
+void arvb_empresta_esq(ArvB<T>* x, int i)
+{
+    ArvB<T>* c = x->filhos[i];
+    ArvB<T>* e = x->filhos[i - 1];
+
+    for(int j = c->n - 1; j >= 0; j--){
+        c->chaves[j + 1] = c->chaves[j];
+        c->dados[j + 1] = c->dados[j];
+    }
+    if(!c->folha){
+        for(int j = c->n; j >= 0; j--)
+            c->filhos[j + 1] = c->filhos[j];
+        c->filhos[0] = e->filhos[e->n];
+        e->filhos[e->n] = nullptr;
+    }
+    c->chaves[0] = x->chaves[i - 1];
+    c->dados[0] = x->dados[i - 1];
+    c->n++;
+
+    x->chaves[i - 1] = e->chaves[e->n - 1];
+    x->dados[i - 1] = e->dados[e->n - 1];
+    e->n--;
+    e->chaves[e->n] = INT_MAX;
+}
+
+// passa uma chave do irmao direito (i+1) para o filho i, via x
+template<typename T>
+void arvb_empresta_dir(ArvB<T>* x, int i)
+{
+    ArvB<T>* c = x->filhos[i];
+    ArvB<T>* d = x->filhos[i + 1];
+
+    c->chaves[c->n] = x->chaves[i];
+    c->dados[c->n] = x->dados[i];
+    if(!c->folha)
+        c->filhos[c->n + 1] = d->filhos[0];
+    c->n++;
+
+    x->chaves[i] = d->chaves[0];
+    x->dados[i] = d->dados[0];
+    for(int j = 0; j < d->n - 1; j++){
+        d->chaves[j] = d->chaves[j + 1];
+        d->dados[j] = d->dados[j + 1];
+    }
+    if(!d->folha){
+        for(int j = 0; j < d->n; j++)
+            d->filhos[j] = d->filhos[j + 1];
+        d->filhos[d->n] = nullptr;
+    }
+    d->n--;
+    d->chaves[d->n] = INT_MAX;
+}
+
+// remove a chave k da subarvore x; x tem pelo menos ARVB_ORDEM chaves
+// (ou e a raiz), entao nunca fica abaixo do minimo
+template<typename T>
+void arvb_remove_no(ArvB<T>* x, int k)
+{
+    const int t = ARVB_ORDEM;
+
+    for(;;){
+        int i = arvb_posicao(x->chaves, k);
+        bool achou = (i < x->n && x->chaves[i] == k);
+
+        if(x->folha){
+            if(!achou)
+                return;
+            for(int j = i; j < x->n - 1; j++){
+                x->chaves[j] = x->chaves[j + 1];
+                x->dados[j] = x->dados[j + 1];
+            }
+            x->n--;
+            x->chaves[x->n] = INT_MAX;
+            return;
+        }
+
+        if(achou){
+            ArvB<T>* y = x->filhos[i];
+            ArvB<T>* z = x->filhos[i + 1];
+            if(y->n >= t){
+                // troca pelo antecessor e o remove da subarvore esquerda
+                ArvB<T>* p = y;
+                while(!p->folha)
+                    p = p->filhos[p->n];
+                x->chaves[i] = p->chaves[p->n - 1];
+                x->dados[i] = p->dados[p->n - 1];
+                k = x->chaves[i];
+                x = y;
+            } else if(z->n >= t){
+                // troca pelo sucessor e o remove da subarvore direita
+                ArvB<T>* s = z;
+                while(!s->folha)
+                    s = s->filhos[0];
+                x->chaves[i] = s->chaves[0];
+                x->dados[i] = s->dados[0];
+                k = x->chaves[i];
+                x = z;
+            } else {
+                arvb_junta(x, i);
+                x = y;
+            }
+            continue;
+        }
+
+        // garante que o filho onde vamos descer tenha folga
+        if(x->filhos[i]->n < t){
+            if(i > 0 && x->filhos[i - 1]->n >= t)
+                arvb_empresta_esq(x, i);
+            else if(i < x->n && x->filhos[i + 1]->n >= t)
+                arvb_empresta_dir(x, i);
+            else if(i < x->n)
+                arvb_junta(x, i);
+            else {
+                arvb_junta(x, i - 1);
+                i--;
+            }
+        }
+        x = x->filhos[i];
+    }
+}
+
+template<typename T>
+ArvB<T>* arvb_remove(ArvB<T>* raiz, T v)
+{
+    if(raiz == nullptr)
+        return raiz;
+
+    int k = arvb_chave<T>()(v);
+    assert(k != INT_MAX);
+    arvb_remove_no(raiz, k);
+
+    if(raiz->n == 0){
+        ArvB<T>* nova = raiz->folha ? nullptr : raiz->filhos[0];
+        delete raiz;
+        return nova;
+    }
+    return raiz;
+}
+
+// aplica f a cada dado da arvore, em ordem crescente de chave
+template<typename T, typename F>
+void arvb_percorre(ArvB<T>* a, F&& f)
+{
+    if(a == nullptr)
+        return;
+    for(int i = 0; i < a->n; i++){
+        arvb_percorre(a->filhos[i], f);
+        f(a->dados[i]);
+    }
+    arvb_percorre(a->filhos[a->n], f);
+}
+
+template<typename T>
+void arvb_emOrdem(ArvB<T>* a, std::list<T>& saida)
+{
+    arvb_percorre(a, [&saida](T& v) { saida.push_back(v); });
+}
+
+template<typename T>
+void arvb_destroi(ArvB<T>* a)
+{
+    if(a != nullptr)
+    {
+        if(!a->folha)
+            for(int i = 0; i <= a->n; i++)
+                arvb_destroi(a->filhos[i]);
+        delete a;
+    }
+}
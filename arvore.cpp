@@ -27,26 +27,28 @@
 #define CATCH_CONFIG_MAIN // O Catch fornece uma main()
 #define CATCH_CONFIG_NO_CPP17_UNCAUGHT_EXCEPTIONS
 #define CATCH_CONFIG_NO_POSIX_SIGNALS
+#define ABB_ESTATISTICAS // os testes tambem exercitam os contadores
 #include "catch.hpp"
 
 #include <list>
 
 #include "abb.hpp"
+#include "arvb.hpp"
 
-template<typename T>
-Abb<T>* abb_inicia(T v);
+template<typename T, typename C>
+Abb<T, C>* abb_inicia(T v);
 
-template<typename T>
-Abb<T>* abb_inicia(std::list<T>& entrada);
+template<typename T, typename C>
+Abb<T, C>* abb_inicia(std::list<T>& entrada);
 
-template<typename T>
-Abb<T>* abb_insere(Abb<T>* no, T v);
+template<typename T, typename C>
+Abb<T, C>* abb_insere(Abb<T, C>* no, T v);
 
-template<typename T>
-Abb<T>* abb_no_minimo(Abb<T>* no);
+template<typename T, typename C>
+Abb<T, C>* abb_no_minimo(Abb<T, C>* no);
 
-template<typename T>
-Abb<T>* abb_remove(Abb<T>* no, T v);
+template<typename T, typename C>
+Abb<T, C>* abb_remove(Abb<T, C>* no, T v);
 
 TEST_CASE("Teste vazio") {
     Abb<int>* a;
@@ -151,4 +153,220 @@ TEST_CASE("Caso simples maior") {
     abb_preOrdem(a, saida);
     REQUIRE(saida == resultado);
     abb_destroi(a);
-}
\ No newline at end of file
+}
+// Verifica as propriedades da arvore B: chaves ordenadas, minimo de chaves
+// por no, posicoes livres com INT_MAX e folhas todas no mesmo nivel.
+template<typename T>
+bool arvb_valida(ArvB<T>* a, int nivel, int& nivel_folha, bool raiz)
+{
+    if(a == nullptr)
+        return true;
+    if(!raiz && a->n < ARVB_ORDEM - 1)
+        return false;
+    for(int i = 1; i < a->n; i++)
+        if(a->chaves[i - 1] >= a->chaves[i])
+            return false;
+    for(int i = a->n; i < ARVB_LARG; i++)
+        if(a->chaves[i] != INT_MAX)
+            return false;
+    if(a->folha){
+        if(nivel_folha < 0)
+            nivel_folha = nivel;
+        return nivel_folha == nivel;
+    }
+    for(int i = 0; i <= a->n; i++)
+        if(!arvb_valida(a->filhos[i], nivel + 1, nivel_folha, false))
+            return false;
+    return true;
+}
+
+TEST_CASE("ArvB vazia") {
+    std::list<int> entrada {};
+    ArvB<int>* a = arvb_inicia(entrada);
+    REQUIRE(arvb_vazio(a) == true);
+    arvb_destroi(a);
+}
+
+TEST_CASE("ArvB posicao SIMD") {
+    alignas(64) int chaves[ARVB_LARG];
+    for(int i = 0; i < ARVB_LARG; i++)
+        chaves[i] = (i < 10) ? i * 10 : INT_MAX;
+    REQUIRE(arvb_posicao(chaves, -5) == 0);
+    REQUIRE(arvb_posicao(chaves, 0) == 0);
+    REQUIRE(arvb_posicao(chaves, 35) == 4);
+    REQUIRE(arvb_posicao(chaves, 90) == 9);
+    REQUIRE(arvb_posicao(chaves, 1000) == 10);
+}
+
+TEST_CASE("ArvB insere e remove em ordem") {
+    ArvB<int>* a = nullptr;
+    std::list<int> esperado;
+    // insere fora de ordem e com repeticoes
+    for(int i = 0; i < 2000; i++)
+        a = arvb_insere(a, (i * 7919) % 1000);
+    for(int i = 0; i < 1000; i++)
+        esperado.push_back(i);
+
+    std::list<int> saida;
+    arvb_emOrdem(a, saida);
+    REQUIRE(saida == esperado);
+    int nivel = -1;
+    REQUIRE(arvb_valida(a, 0, nivel, true));
+    REQUIRE(arvb_busca(a, 123) != nullptr);
+
+    // remove os pares
+    for(int i = 0; i < 1000; i += 2)
+        a = arvb_remove(a, i);
+    esperado.remove_if([](int v) { return v % 2 == 0; });
+    saida.clear();
+    arvb_emOrdem(a, saida);
+    REQUIRE(saida == esperado);
+    nivel = -1;
+    REQUIRE(arvb_valida(a, 0, nivel, true));
+    REQUIRE(arvb_busca(a, 124) == nullptr);
+
+    for(int i = 1; i < 1000; i += 2)
+        a = arvb_remove(a, i);
+    REQUIRE(arvb_vazio(a) == true);
+}
+
+// Verifica ordem, balanceamento AVL e ponteiros para o pai, retornando a
+// altura (ou -1 se invalida)
+template<typename T, typename C>
+int abb_valida(Abb<T, C>* a)
+{
+    if(a == nullptr)
+        return 0;
+    if((a->esq && a->esq->pai != a) || (a->dir && a->dir->pai != a))
+        return -1;
+    int he = abb_valida(a->esq);
+    int hd = abb_valida(a->dir);
+    if(he < 0 || hd < 0 || std::abs(he - hd) > 1)
+        return -1;
+    if((a->esq && C()(a->esq->dado, a->dado) >= 0) || (a->dir && C()(a->dado, a->dir->dado) >= 0))
+        return -1;
+    if(a->altura != 1 + std::max(he, hd))
+        return -1;
+    return a->altura;
+}
+
+TEST_CASE("Abb paralela") {
+    paralelo::Pool pool;
+    pool.inicia(4);
+
+    std::vector<int> ordenados;
+    for(int i = 0; i < 100000; i++)
+        ordenados.push_back(i * 2);
+    Abb<int>* a = abb_inicia_ordenado(ordenados, pool);
+    REQUIRE(abb_valida(a) > 0);
+
+    std::list<int> saida;
+    abb_percorre(a, [&saida](int& v) { saida.push_back(v); });
+    REQUIRE(saida == std::list<int>(ordenados.begin(), ordenados.end()));
+
+    std::atomic<long> soma{0};
+    abb_percorre_paralelo(a, [&soma](int& v) { soma += v; v++; }, pool);
+    REQUIRE(soma == 100000L * 99999L);
+    REQUIRE(a->dado % 2 == 1);
+
+    abb_destroi_paralelo(a, pool);
+    pool.finaliza();
+}
+
+TEST_CASE("Abb estatisticas") {
+    Abb<int>* a;
+    std::list<int> entrada {1, 3, 2};
+    AbbEstatisticas antes = abb_estat_le();
+    a = abb_inicia(entrada);
+    AbbEstatisticas depois = abb_estat_le();
+    REQUIRE(depois.c[ABB_ALOCACOES] - antes.c[ABB_ALOCACOES] == 3);
+    REQUIRE(depois.c[ABB_ROT_DIR_ESQ] - antes.c[ABB_ROT_DIR_ESQ] == 1);
+    REQUIRE(depois.c[ABB_ROT_ESQ] - antes.c[ABB_ROT_ESQ] == 1);
+    REQUIRE(depois.c[ABB_ROT_DIR] - antes.c[ABB_ROT_DIR] == 1);
+    // 2 cai na profundidade 2 (abaixo de 1 e de 3)
+    REQUIRE(depois.hist[2] - antes.hist[2] == 1);
+    abb_destroi(a);
+    REQUIRE(abb_estat_le().c[ABB_LIBERACOES] - antes.c[ABB_LIBERACOES] == 3);
+}
+
+TEST_CASE("Abb insere com dica") {
+    Abb<int>* a = nullptr;
+    std::list<int> esperado;
+    // insercoes agrupadas: cada valor usa o anterior como dica
+    Abb<int>* dica = nullptr;
+    for(int i = 0; i < 5000; i++)
+    {
+        a = abb_insere_dica(a, dica, i);
+        dica = abb_busca(a, i);
+        esperado.push_back(i);
+    }
+    REQUIRE(a->pai == nullptr);
+    REQUIRE(abb_valida(a) > 0);
+    REQUIRE(abb_altura(a) <= 18);
+
+    // dicas longe do valor (sobe ate a raiz se preciso)
+    for(int i = 0; i < 3000; i++)
+    {
+        int v = 5000 + (i * 7919) % 3000;
+        a = abb_insere_dica(a, abb_busca(a, (i * 31) % 5000), v);
+    }
+    for(int i = 5000; i < 8000; i++)
+        esperado.push_back(i);
+    REQUIRE(abb_valida(a) > 0);
+
+    // remove e insere de novo pelos lados, como cria_novo_invader
+    for(int i = 0; i < 8000; i += 3)
+        a = abb_remove(a, i);
+    for(int i = 0; i < 8000; i += 3)
+        a = abb_insere_dica(a, (i < a->dado) ? a->esq : a->dir, i);
+    REQUIRE(abb_valida(a) > 0);
+
+    std::list<int> saida;
+    abb_percorre(a, [&saida](int& v) { saida.push_back(v); });
+    REQUIRE(saida == esperado);
+    abb_destroi(a);
+}
+
+// dado com dois campos, ordenado por um comparador que nao usa o primeiro
+struct Nave {
+    int valor;
+    int criacao;
+};
+
+struct PorCriacao {
+    int operator()(const Nave& a, const Nave& b) const {
+        return (a.criacao > b.criacao) - (a.criacao < b.criacao);
+    }
+};
+
+TEST_CASE("Abb com comparador") {
+    Abb<Nave, PorCriacao>* a = nullptr;
+    for(int i = 0; i < 100; i++)
+        a = abb_insere(a, Nave{i, (i * 37) % 100});
+    // repetido pela chave de criacao, ignorado
+    a = abb_insere(a, Nave{-1, 5});
+    REQUIRE(abb_valida(a) > 0);
+
+    std::list<int> saida;
+    abb_percorre(a, [&saida](Nave& n) { saida.push_back(n.criacao); });
+    std::list<int> esperado;
+    for(int i = 0; i < 100; i++)
+        esperado.push_back(i);
+    REQUIRE(saida == esperado);
+
+    Abb<Nave, PorCriacao>* n = abb_busca(a, Nave{0, 37});
+    REQUIRE(n != nullptr);
+    REQUIRE(n->dado.valor == 1);
+
+    a = abb_remove(a, Nave{0, 37});
+    REQUIRE(abb_busca(a, Nave{0, 37}) == nullptr);
+    REQUIRE(abb_valida(a) > 0);
+    abb_destroi(a);
+}
+
+TEST_CASE("AbbCompara tres vias") {
+    AbbCompara<int> c;
+    REQUIRE(c(1, 2) < 0);
+    REQUIRE(c(2, 2) == 0);
+    REQUIRE(c(3, 2) > 0);
+}
@@ -0,0 +1,536 @@
+// bench.cpp
+// Medidas de desempenho das estruturas usadas pelo jogo Invaders.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2023 João Vicente Ferreira Lima, UFSM
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "abb.hpp"
+#include "arvb.hpp"
+#include "bvh.hpp"
+#include "fixo.hpp"
+#include "geom.hpp"
+#include "grade.hpp"
+#include "mascara.hpp"
+#include "paralelo.hpp"
+#include "quadro.hpp"
+#include "quadtree.hpp"
+#include "varredura.hpp"
+
+using namespace geom;
+
+// tempo em milissegundos gasto por f()
+template<typename F>
+double cronometra(F&& f)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    f();
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+void relata(const char* nome, int n, double ms)
+{
+    std::cout << "  " << nome << ": " << ms << " ms ("
+              << (ms * 1e6 / n) << " ns/op)" << std::endl;
+}
+
+// compara a AVL (Abb) com a arvore B (ArvB) inserindo, buscando e removendo
+// n chaves aleatorias distintas
+void bench_arvores(int n)
+{
+    std::vector<int> chaves(n);
+    for(int i = 0; i < n; i++)
+        chaves[i] = i;
+    std::mt19937 gen(42);
+    std::shuffle(chaves.begin(), chaves.end(), gen);
+
+    std::cout << "arvores, n = " << n << std::endl;
+
+    Abb<int>* abb = nullptr;
+    relata("Abb insere", n, cronometra([&] {
+        for(int k : chaves)
+            abb = abb_insere(abb, k);
+    }));
+    volatile long soma = 0; // evita que o compilador descarte as buscas
+    relata("Abb busca", n, cronometra([&] {
+        for(int k : chaves){
+            Abb<int>* no = abb;
+            while(no != nullptr && no->dado != k)
+                no = (k < no->dado) ? no->esq : no->dir;
+            soma = soma + no->dado;
+        }
+    }));
+    relata("Abb remove", n, cronometra([&] {
+        for(int k : chaves)
+            abb = abb_remove(abb, k);
+    }));
+
+    ArvB<int>* arvb = nullptr;
+    relata("ArvB insere", n, cronometra([&] {
+        for(int k : chaves)
+            arvb = arvb_insere(arvb, k);
+    }));
+    relata("ArvB busca", n, cronometra([&] {
+        for(int k : chaves)
+            soma = soma + *arvb_busca(arvb, k);
+    }));
+    relata("ArvB remove", n, cronometra([&] {
+        for(int k : chaves)
+            arvb = arvb_remove(arvb, k);
+    }));
+
+    abb_destroi(abb);
+    arvb_destroi(arvb);
+}
+
+// construcao em bloco, percurso e destruicao da Abb com 1 thread e com
+// todas as threads da maquina
+void bench_paralelo(int n)
+{
+    std::vector<int> ordenados(n);
+    for(int i = 0; i < n; i++)
+        ordenados[i] = i;
+
+    int nthreads = std::thread::hardware_concurrency();
+    for(int t : {1, nthreads}){
+        paralelo::Pool pool;
+        pool.inicia(t);
+        std::cout << "abb paralela, n = " << n << ", threads = " << t << std::endl;
+
+        Abb<int>* a = nullptr;
+        relata("constroi", n, cronometra([&] { a = abb_inicia_ordenado(ordenados, pool); }));
+        relata("percorre", n, cronometra([&] {
+            abb_percorre_paralelo(a, [](int& v) { v = v * 3 + 1; }, pool);
+        }));
+        relata("destroi", n, cronometra([&] { abb_destroi_paralelo(a, pool); }));
+        pool.finaliza();
+    }
+}
+
+// um circulo contra n retangulos, em lote (SIMD) e escalar
+void bench_lote(int n)
+{
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<float> px(0, 600), py(0, 400);
+    LoteRetangulos l;
+    for(int i = 0; i < n; i++)
+        lote_insere(l, Retangulo{{px(gen), py(gen)}, {20, 20}});
+    std::vector<uint64_t> m;
+    const int tiros = 100;
+
+    std::cout << "colisao em lote, n = " << n << " (" << LOTE_LARGURA
+              << " por instrucao)" << std::endl;
+    relata("intercr_lote_escalar", n * tiros, cronometra([&] {
+        for(int t = 0; t < tiros; t++)
+            intercr_lote_escalar(Circulo{{px(gen), py(gen)}, 5}, l, m);
+    }));
+    relata("intercr_lote", n * tiros, cronometra([&] {
+        for(int t = 0; t < tiros; t++)
+            intercr_lote(Circulo{{px(gen), py(gen)}, 5}, l, m);
+    }));
+}
+
+// tiros contra n retangulos: todos contra todos e pela grade (incluindo a
+// montagem da grade, feita a cada quadro no jogo)
+void bench_grade(int n)
+{
+    std::mt19937 gen(8);
+    std::uniform_real_distribution<float> px(0, 6000), py(0, 4000);
+    LoteRetangulos l;
+    for(int i = 0; i < n; i++)
+        lote_insere(l, Retangulo{{px(gen), py(gen)}, {20, 20}});
+    const int tiros = 1000;
+    std::vector<Circulo> cs;
+    for(int t = 0; t < tiros; t++)
+        cs.push_back(Circulo{{px(gen), py(gen)}, 5});
+    volatile int acertos = 0;
+
+    std::cout << "grade, n = " << n << ", " << tiros << " tiros" << std::endl;
+    relata("forca bruta", n * tiros, cronometra([&] {
+        for(Circulo& c : cs)
+            for(int i = 0; i < n; i++)
+                if(intercr_lote_um(c, l, i))
+                    acertos = acertos + 1;
+    }));
+    Grade g;
+    grade_inicia(g, 32, n);
+    std::vector<int> candidatos;
+    relata("grade", n * tiros, cronometra([&] {
+        grade_constroi(g, l);
+        for(Circulo& c : cs){
+            grade_consulta(g, caixa(c), candidatos);
+            for(int i : candidatos)
+                if(intercr_lote_um(c, l, i))
+                    acertos = acertos + 1;
+        }
+    }));
+}
+
+// formacao de n retangulos andando junta: todos contra todos a cada quadro
+// e pela varredura, que aproveita a ordem do quadro anterior
+void bench_varredura(int n)
+{
+    std::vector<Retangulo> rs;
+    int colunas = 100;
+    for(int i = 0; i < n; i++)
+        rs.push_back(Retangulo{{float(i % colunas) * 25, float(i / colunas) * 25}, {20, 20}});
+    const int quadros = 100;
+    volatile int pares = 0;
+
+    std::cout << "varredura, n = " << n << ", " << quadros << " quadros" << std::endl;
+    relata("forca bruta", n * quadros, cronometra([&] {
+        for(int q = 0; q < quadros; q++)
+            for(int i = 0; i < n; i++)
+                for(int j = i + 1; j < n; j++)
+                    if(interrr(rs[i], rs[j]))
+                        pares = pares + 1;
+    }));
+    Varredura s;
+    for(Retangulo& r : rs)
+        varredura_insere(s, r);
+    varredura_atualiza(s);
+    relata("varredura", n * quadros, cronometra([&] {
+        for(int q = 0; q < quadros; q++){
+            varredura_limpa_eventos(s);
+            float dx = (q / 10 % 2) ? -2 : 2;
+            for(int i = 0; i < n; i++){
+                Retangulo r = s.caixas[i];
+                r.pos.x += dx;
+                varredura_move(s, i, r);
+            }
+            varredura_atualiza(s);
+            pares = pares + s.pares.size();
+        }
+    }));
+}
+
+// consultas de raio, circulo e retangulo contra n retangulos: todos contra
+// todos e pela Bvh. A densidade e a mesma para todo n.
+void bench_bvh(int n)
+{
+    std::mt19937 gen(12);
+    float lado = std::sqrt(float(n)) * 25;
+    std::uniform_real_distribution<float> px(0, lado), pd(-1, 1);
+    std::vector<Retangulo> rs;
+    for(int i = 0; i < n; i++)
+        rs.push_back(Retangulo{{px(gen), px(gen)}, {20, 20}});
+    const int consultas = 100;
+    std::vector<Circulo> cs;
+    std::vector<Retangulo> qs;
+    std::vector<Ponto> os, ds;
+    for(int k = 0; k < consultas; k++){
+        cs.push_back(Circulo{{px(gen), px(gen)}, 40});
+        qs.push_back(Retangulo{{px(gen), px(gen)}, {60, 60}});
+        os.push_back(Ponto{px(gen), px(gen)});
+        ds.push_back(Ponto{pd(gen), pd(gen)});
+    }
+    volatile int achados = 0;
+    std::vector<int> saida;
+
+    std::cout << "bvh, n = " << n << ", " << consultas << " consultas" << std::endl;
+    relata("forca bruta circulo", n * consultas, cronometra([&] {
+        for(Circulo& c : cs)
+            for(Retangulo& r : rs)
+                if(intercr(c, r))
+                    achados = achados + 1;
+    }));
+    relata("forca bruta retangulo", n * consultas, cronometra([&] {
+        for(Retangulo& q : qs)
+            for(Retangulo& r : rs)
+                if(interrr(q, r))
+                    achados = achados + 1;
+    }));
+    relata("forca bruta raio", n * consultas, cronometra([&] {
+        for(int k = 0; k < consultas; k++){
+            float t = 1000;
+            for(Retangulo& r : rs){
+                float tr = tempo_raio(os[k], ds[k], r, t);
+                if(tr >= 0)
+                    t = tr;
+            }
+            achados = achados + (t < 1000);
+        }
+    }));
+
+    Bvh b;
+    relata("bvh constroi", n, cronometra([&] { bvh_constroi(b, rs); }));
+    for(Retangulo& r : rs)
+        r.pos.x += 2;
+    relata("bvh ajusta", n, cronometra([&] { bvh_ajusta(b, rs); }));
+    relata("bvh circulo", n * consultas, cronometra([&] {
+        for(Circulo& c : cs){
+            bvh_circulo(b, c, saida);
+            achados = achados + saida.size();
+        }
+    }));
+    relata("bvh retangulo", n * consultas, cronometra([&] {
+        for(Retangulo& q : qs){
+            bvh_retangulo(b, q, saida);
+            achados = achados + saida.size();
+        }
+    }));
+    relata("bvh raio", n * consultas, cronometra([&] {
+        for(int k = 0; k < consultas; k++){
+            float t;
+            achados = achados + (bvh_raio(b, os[k], ds[k], 1000, t) >= 0);
+        }
+    }));
+}
+
+// n retangulos concentrados em uma faixa do campo, andando juntos, e
+// consultas por area: todos contra todos e pela quadtree (movendo todos a
+// cada quadro)
+void bench_quadtree(int n)
+{
+    std::mt19937 gen(13);
+    float larg = std::sqrt(float(n)) * 60;
+    std::uniform_real_distribution<float> px(0, larg), py(0, larg / 4), pq(0, larg);
+    std::vector<Retangulo> rs;
+    for(int i = 0; i < n; i++)
+        rs.push_back(Retangulo{{px(gen), py(gen)}, {20, 20}});
+    const int quadros = 10, consultas = 100;
+    std::vector<Retangulo> qs;
+    for(int k = 0; k < consultas; k++)
+        qs.push_back(Retangulo{{pq(gen), pq(gen)}, {30, 30}});
+    volatile int achados = 0;
+
+    std::cout << "quadtree, n = " << n << ", " << quadros << " quadros de "
+              << consultas << " consultas" << std::endl;
+    relata("forca bruta", n * quadros * consultas, cronometra([&] {
+        for(int q = 0; q < quadros; q++)
+            for(Retangulo& a : qs)
+                for(Retangulo& r : rs)
+                    if(interrr(a, r))
+                        achados = achados + 1;
+    }));
+    Quadtree t;
+    quadtree_inicia(t, Retangulo{{0, 0}, {larg, larg}});
+    std::vector<int> ids, saida;
+    relata("quadtree insere", n, cronometra([&] {
+        for(Retangulo& r : rs)
+            ids.push_back(quadtree_insere(t, r));
+    }));
+    relata("quadtree move", n * quadros, cronometra([&] {
+        for(int q = 0; q < quadros; q++)
+            for(int id : ids){
+                Retangulo r = t.itens[id].r;
+                r.pos.x += 2;
+                r.pos.y += 1;
+                quadtree_move(t, id, r);
+            }
+    }));
+    relata("quadtree consulta", n * quadros * consultas, cronometra([&] {
+        for(int q = 0; q < quadros; q++)
+            for(Retangulo& a : qs){
+                quadtree_consulta(t, a, saida);
+                achados = achados + saida.size();
+            }
+    }));
+}
+
+// os mesmos testes em lote em float e em ponto fixo
+void bench_fixo(int n)
+{
+    std::mt19937 gen(14);
+    std::uniform_real_distribution<float> px(0, 600), py(0, 400);
+    LoteRetangulos l;
+    fixo::LoteRetangulos lf;
+    for(int i = 0; i < n; i++){
+        Retangulo r{{px(gen), py(gen)}, {20, 20}};
+        lote_insere(l, r);
+        fixo::lote_insere(lf, r);
+    }
+    const int testes = 100;
+    std::vector<Circulo> cs;
+    std::vector<Retangulo> rs;
+    for(int t = 0; t < testes; t++){
+        cs.push_back(Circulo{{px(gen), py(gen)}, 5});
+        rs.push_back(Retangulo{{px(gen), py(gen)}, {10, 20}});
+    }
+    std::vector<uint64_t> m;
+
+    std::cout << "ponto fixo, n = " << n << " (float " << LOTE_LARGURA
+              << " e fixo " << fixo::LOTE_LARGURA << " por instrucao)" << std::endl;
+    relata("intercr_lote float", n * testes, cronometra([&] {
+        for(Circulo& c : cs)
+            intercr_lote(c, l, m);
+    }));
+    relata("intercr_lote fixo", n * testes, cronometra([&] {
+        for(Circulo& c : cs)
+            fixo::intercr_lote(fixo::converte(c), lf, m);
+    }));
+    relata("interrr_lote float", n * testes, cronometra([&] {
+        for(Retangulo& r : rs)
+            interrr_lote(r, l, m);
+    }));
+    relata("interrr_lote fixo", n * testes, cronometra([&] {
+        for(Retangulo& r : rs)
+            fixo::interrr_lote(fixo::converte(r), lf, m);
+    }));
+}
+
+Mascara mascara_cheia(std::mt19937& gen, int larg, int alt)
+{
+    std::bernoulli_distribution liga(0.5);
+    Mascara m;
+    mascara_inicia(m, larg, alt);
+    for(int y = 0; y < alt; y++)
+        for(int x = 0; x < larg; x++)
+            if(liga(gen))
+                mascara_liga(m, x, y);
+    return m;
+}
+
+// mascaras que se sobrepoem em caixa mas nunca em pixels: o pior caso, que
+// percorre todas as linhas em comum
+void bench_mascara(int n)
+{
+    std::mt19937 gen(15);
+    std::uniform_int_distribution<int> px(-20, 20);
+    Mascara a = mascara_cheia(gen, 48, 32), b = mascara_cheia(gen, 48, 32);
+    Mascara escudo = mascara_cheia(gen, 120, 40), c = mascara_cheia(gen, 120, 40);
+    for(uint64_t& w : b.bits)
+        w = 0;
+    for(uint64_t& w : c.bits)
+        w = 0;
+    std::vector<std::pair<int, int>> pos(n);
+    for(auto& p : pos)
+        p = {px(gen), px(gen)};
+
+    auto pixels = [](const Mascara& a, const Mascara& b, int bx, int by) {
+        for(int y = 0; y < a.alt; y++)
+            for(int x = 0; x < a.larg; x++) {
+                int u = x - bx, v = y - by;
+                if(mascara_bit(a, x, y) && u >= 0 && u < b.larg && v >= 0 && v < b.alt &&
+                   mascara_bit(b, u, v))
+                    return true;
+            }
+        return false;
+    };
+    volatile int toques = 0;
+
+    std::cout << "mascaras, n = " << n << std::endl;
+    relata("toca 48x32 pixel a pixel", n, cronometra([&] {
+        for(auto [x, y] : pos)
+            toques = toques + pixels(a, b, x, y);
+    }));
+    relata("toca 48x32", n, cronometra([&] {
+        for(auto [x, y] : pos)
+            toques = toques + mascara_toca(a, 0, 0, b, x, y);
+    }));
+    relata("toca 120x40 pixel a pixel", n, cronometra([&] {
+        for(auto [x, y] : pos)
+            toques = toques + pixels(escudo, c, x, y);
+    }));
+    relata("toca 120x40", n, cronometra([&] {
+        for(auto [x, y] : pos)
+            toques = toques + mascara_toca(escudo, 0, 0, c, x, y);
+    }));
+
+    Mascara cratera;
+    mascara_circulo(cratera, 6);
+    std::uniform_int_distribution<int> ex(-6, 120), ey(-6, 40);
+    relata("apaga cratera de raio 6", n, cronometra([&] {
+        for(int k = 0; k < n; k++)
+            toques = toques + mascara_apaga(escudo, 0, 0, cratera, ex(gen), ey(gen));
+    }));
+}
+
+// um quadro do jogo desenhado por software: um retangulo, uma linha e um
+// numero por invader, mais alguns tiros
+void bench_quadro(int n)
+{
+    tela::Quadro q;
+    tela::quadro_inicia(q, 600, 400);
+    tela::Fonte f;
+    bool com_fonte = tela::quadro_fonte(f, "data/fixed_font.tga");
+    std::mt19937 gen(16);
+    std::uniform_real_distribution<float> px(0, 580), py(0, 380);
+    std::vector<Retangulo> rs;
+    for(int i = 0; i < n; i++)
+        rs.push_back(Retangulo{{px(gen), py(gen)}, {20, 20}});
+    const int quadros = 100;
+    const uint32_t fundo = tela::quadro_rgba(255, 255, 255);
+    const uint32_t vermelho = tela::quadro_rgba(255, 51, 0);
+    const uint32_t azul = tela::quadro_rgba(51, 76, 204);
+    const uint32_t preto = tela::quadro_rgba(0, 0, 0);
+
+    std::cout << "desenho por software 600x400, n = " << n << std::endl;
+    relata("limpa", quadros, cronometra([&] {
+        for(int k = 0; k < quadros; k++)
+            tela::quadro_limpa(q, fundo);
+    }));
+    auto desenha = [&] {
+        for(int i = 0; i < n; i++) {
+            tela::quadro_retangulo(q, rs[i], vermelho);
+            tela::quadro_linha(q, rs[i].pos, rs[(i + 1) / 2].pos, azul);
+        }
+        for(int t = 0; t < 10; t++)
+            tela::quadro_circulo(q, Circulo{{rs[t % n].pos.x, 390}, 5}, vermelho);
+        if(com_fonte)
+            for(int i = 0; i < n; i++)
+                tela::quadro_texto(q, f, rs[i].pos, "57", preto);
+    };
+    relata("quadro inteiro", quadros, cronometra([&] {
+        for(int k = 0; k < quadros; k++) {
+            tela::quadro_limpa(q, fundo);
+            desenha();
+        }
+    }));
+    // so a faixa de baixo suja (laser e tiros), como Tela::limpa_regiao
+    relata("regiao suja 600x40", quadros, cronometra([&] {
+        for(int k = 0; k < quadros; k++) {
+            tela::quadro_corta(q, 0, 360, 600, 400);
+            tela::quadro_limpa(q, fundo);
+            desenha();
+        }
+        tela::quadro_descorta(q);
+    }));
+}
+
+int main(int argc, char** argv)
+{
+    int n = (argc > 1) ? std::atoi(argv[1]) : 500000;
+
+    bench_arvores(n);
+    bench_paralelo(n * 4);
+    bench_lote(n / 10);
+    bench_grade(n / 10);
+    bench_varredura(n / 100);
+    for(int m = 1000; m <= 1000000; m *= 10)
+        bench_bvh(m);
+    bench_quadtree(n / 10);
+    bench_fixo(n / 10);
+    bench_mascara(n / 10);
+    for(int m = 10; m <= 10000; m *= 10)
+        bench_quadro(m);
+    return 0;
+}
@@ -0,0 +1,187 @@
+// bvh.hpp
+// Hierarquia de caixas envolventes (BVH) sobre retangulos, para consultas
+// de raio, circulo e retangulo contra a formacao sem testar todos os
+// invaders.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2023 João Vicente Ferreira Lima, UFSM
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "geom.hpp"
+
+namespace geom {
+
+// retangulos por folha
+const int BVH_FOLHA = 4;
+// profundidade maxima; a divisao pela mediana da no maximo log2(n) niveis
+const int BVH_PILHA = 64;
+
+// Os nos ficam em um vetor, em pre-ordem: o filho esquerdo de um no interno
+// vem logo depois dele e 'dir' aponta o direito. Uma folha guarda os
+// indices 'itens[primeiro]' ate 'itens[primeiro+n-1]'. Os indices sao os
+// do vetor de retangulos passado a bvh_constroi.
+struct Bvh {
+    struct No {
+        Retangulo caixa;
+        int dir;      // filho direito (no interno)
+        int primeiro; // primeiro item (folha)
+        int n;        // itens na folha; 0 em no interno
+    };
+
+    std::vector<No> nos;
+    std::vector<int> itens;
+    std::vector<Retangulo> caixas; // copia dos retangulos de cada indice
+};
+
+inline Retangulo bvh_caixa_itens(const Bvh& b, int primeiro, int n) {
+    Retangulo c = b.caixas[b.itens[primeiro]];
+    for (int k = 1; k < n; k++)
+        c = uniao(c, b.caixas[b.itens[primeiro + k]]);
+    return c;
+}
+
+// monta o no com os itens [primeiro, primeiro+n) e retorna seu indice;
+// divide pela mediana dos centros no eixo mais comprido
+inline int bvh_constroi_no(Bvh& b, int primeiro, int n) {
+    int i = b.nos.size();
+    b.nos.push_back({bvh_caixa_itens(b, primeiro, n), 0, primeiro, n});
+    if (n <= BVH_FOLHA)
+        return i;
+
+    Retangulo c = b.nos[i].caixa;
+    bool em_x = c.tam.larg >= c.tam.alt;
+    auto centro = [&b, em_x](int k) {
+        const Retangulo& r = b.caixas[k];
+        return em_x ? 2 * r.pos.x + r.tam.larg : 2 * r.pos.y + r.tam.alt;
+    };
+    int m = n / 2;
+    std::nth_element(b.itens.begin() + primeiro, b.itens.begin() + primeiro + m,
+                     b.itens.begin() + primeiro + n,
+                     [&centro](int u, int v) { return centro(u) < centro(v); });
+
+    b.nos[i].n = 0;
+    bvh_constroi_no(b, primeiro, m);
+    int dir = bvh_constroi_no(b, primeiro + m, n - m);
+    b.nos[i].dir = dir;
+    return i;
+}
+
+// monta a hierarquia sobre os retangulos rs (indice k = rs[k])
+inline void bvh_constroi(Bvh& b, const std::vector<Retangulo>& rs) {
+    b.caixas = rs;
+    b.itens.resize(rs.size());
+    for (size_t k = 0; k < rs.size(); k++)
+        b.itens[k] = k;
+    b.nos.clear();
+    b.nos.reserve(2 * rs.size() / BVH_FOLHA + 1);
+    if (!rs.empty())
+        bvh_constroi_no(b, 0, rs.size());
+}
+
+// Atualiza as caixas depois que os retangulos andaram, sem mudar a
+// estrutura. Serve enquanto a formacao anda junta: as caixas continuam
+// justas. Depois de muitas remocoes ou de mudancas de forma, e melhor
+// chamar bvh_constroi de novo.
+inline void bvh_ajusta(Bvh& b, const std::vector<Retangulo>& rs) {
+    b.caixas = rs;
+    // em pre-ordem os filhos vem depois do pai: basta percorrer de tras
+    // para frente
+    for (int i = (int)b.nos.size() - 1; i >= 0; i--) {
+        Bvh::No& no = b.nos[i];
+        if (no.n > 0)
+            no.caixa = bvh_caixa_itens(b, no.primeiro, no.n);
+        else
+            no.caixa = uniao(b.nos[i + 1].caixa, b.nos[no.dir].caixa);
+    }
+}
+
+// percorre os nos cuja caixa passa em 'entra' e chama f(indice) para cada
+// item das folhas alcancadas
+template <typename E, typename F>
+void bvh_percorre(const Bvh& b, E&& entra, F&& f) {
+    if (b.nos.empty())
+        return;
+    int pilha[BVH_PILHA];
+    int topo = 0;
+    pilha[topo++] = 0;
+    while (topo > 0) {
+        int i = pilha[--topo];
+        const Bvh::No& no = b.nos[i];
+        if (!entra(no.caixa))
+            continue;
+        if (no.n > 0) {
+            for (int k = 0; k < no.n; k++)
+                f(b.itens[no.primeiro + k]);
+        } else {
+            pilha[topo++] = no.dir;
+            pilha[topo++] = i + 1;
+        }
+    }
+}
+
+// coloca em 'saida' os indices dos retangulos que tocam r
+inline void bvh_retangulo(const Bvh& b, Retangulo r, std::vector<int>& saida) {
+    saida.clear();
+    bvh_percorre(
+        b, [r](const Retangulo& c) { return interrr(r, c); },
+        [&](int k) {
+            if (interrr(r, b.caixas[k]))
+                saida.push_back(k);
+        });
+}
+
+// coloca em 'saida' os indices dos retangulos que tocam c
+inline void bvh_circulo(const Bvh& b, Circulo c, std::vector<int>& saida) {
+    saida.clear();
+    bvh_percorre(
+        b, [c](const Retangulo& r) { return intercr(c, r); },
+        [&](int k) {
+            if (intercr(c, b.caixas[k]))
+                saida.push_back(k);
+        });
+}
+
+// Primeiro retangulo atingido pelo raio o + t*d, 0 <= t <= tmax (um feixe
+// de tamanho tmax*|d|). Retorna o indice, ou -1, e o instante em t. Em
+// empate fica o menor indice. Os nos mais longe que o melhor ate agora sao
+// pulados.
+inline int bvh_raio(const Bvh& b, Ponto o, Ponto d, float tmax, float& t) {
+    int melhor = -1;
+    t = tmax;
+    bvh_percorre(
+        b, [&](const Retangulo& c) { return tempo_raio(o, d, c, t) >= 0; },
+        [&](int k) {
+            float tk = tempo_raio(o, d, b.caixas[k], t);
+            if (tk >= 0 && (melhor < 0 || tk < t || (tk == t && k < melhor))) {
+                melhor = k;
+                t = tk;
+            }
+        });
+    return melhor;
+}
+
+}; // namespace geom
@@ -0,0 +1,84 @@
+// compara.cpp
+// Compara duas capturas de tela (PPM) pixel a pixel, com tolerancia por
+// canal, para conferir que uma mudanca no desenho nao mudou a imagem.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2023 João Vicente Ferreira Lima, UFSM
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// uso: compara referencia.ppm nova.ppm [tolerancia [diferencas.ppm]]
+// Retorna 0 se as imagens forem iguais dentro da tolerancia, 1 se forem
+// diferentes e 2 se alguma nao puder ser lida. Em diferencas.ppm ficam os
+// pixels diferentes em vermelho sobre a referencia clareada.
+
+#include <cstdlib>
+#include <iostream>
+
+#include "quadro.hpp"
+
+using namespace tela;
+
+int main(int argc, char** argv)
+{
+    if(argc < 3) {
+        std::cerr << "uso: " << argv[0]
+                  << " referencia.ppm nova.ppm [tolerancia [diferencas.ppm]]" << std::endl;
+        return 2;
+    }
+    Quadro a, b;
+    if(!quadro_le_ppm(argv[1], a)) {
+        std::cerr << "falha ao ler " << argv[1] << std::endl;
+        return 2;
+    }
+    if(!quadro_le_ppm(argv[2], b)) {
+        std::cerr << "falha ao ler " << argv[2] << std::endl;
+        return 2;
+    }
+    int tolerancia = (argc > 3) ? std::atoi(argv[3]) : 0;
+
+    QuadroDiferenca d = quadro_compara(a, b, tolerancia);
+    if(d.pixels < 0) {
+        std::cout << "tamanhos diferentes: " << a.larg << "x" << a.alt << " e " << b.larg
+                  << "x" << b.alt << std::endl;
+        return 1;
+    }
+    std::cout << d.pixels << " pixels diferentes (tolerancia " << tolerancia
+              << ", maior diferenca " << d.maior << ")" << std::endl;
+
+    if(argc > 4) {
+        Quadro m;
+        quadro_inicia(m, a.larg, a.alt);
+        for(size_t k = 0; k < m.px.size(); k++) {
+            uint32_t p = a.px[k];
+            // a referencia bem clara, para o vermelho aparecer
+            m.px[k] = quadro_rgba(192 + (p & 0xff) / 4, 192 + (p >> 8 & 0xff) / 4,
+                                  192 + (p >> 16 & 0xff) / 4);
+            if(quadro_difere(p, b.px[k]) > tolerancia)
+                m.px[k] = quadro_rgba(255, 0, 0);
+        }
+        if(!quadro_grava_ppm(m, argv[4])) {
+            std::cerr << "falha ao gravar " << argv[4] << std::endl;
+            return 2;
+        }
+    }
+    return d.pixels > 0;
+}
@@ -0,0 +1,95 @@
+// concorrencia.cpp
+// Testes da troca de dados entre threads (paralelo.hpp) e das medidas de
+// tempo (tempo.hpp).
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2023 João Vicente Ferreira Lima, UFSM
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define CATCH_CONFIG_MAIN // O Catch fornece uma main()
+#define CATCH_CONFIG_NO_CPP17_UNCAUGHT_EXCEPTIONS
+#define CATCH_CONFIG_NO_POSIX_SIGNALS
+#include "catch.hpp"
+
+#include <thread>
+#include <vector>
+
+#include "paralelo.hpp"
+#include "tempo.hpp"
+
+TEST_CASE("Triplo entrega o valor mais recente") {
+    paralelo::Triplo<std::vector<int>> t;
+    REQUIRE(!t.troca());
+
+    const int n = 100000;
+    std::thread produtor([&t] {
+        for(int i = 1; i <= n; i++) {
+            // o buffer reaproveitado e todo reescrito
+            std::vector<int>& v = t.escreve();
+            v.assign(3, i);
+            t.publica();
+        }
+    });
+    int ultimo = 0, lidos = 0;
+    while(ultimo < n) {
+        t.espera();
+        REQUIRE(t.troca());
+        const std::vector<int>& v = t.le();
+        // nunca um valor misturado nem mais velho que o anterior
+        REQUIRE(v.size() == 3);
+        REQUIRE(v[0] == v[2]);
+        REQUIRE(v[0] > ultimo);
+        ultimo = v[0];
+        lidos++;
+    }
+    produtor.join();
+    REQUIRE(lidos <= n);
+    REQUIRE(!t.troca());
+    REQUIRE(t.le()[1] == n);
+}
+
+TEST_CASE("Histograma de tempos") {
+    // faixas contiguas e crescentes
+    for(uint32_t us = 0; us < 100000; us++) {
+        int k = tempo::histograma_faixa(us);
+        REQUIRE(tempo::histograma_inicio(k) <= us);
+        REQUIRE(us < tempo::histograma_inicio(k + 1));
+    }
+    REQUIRE(tempo::histograma_faixa(4294967295u) == tempo::HISTOGRAMA_FAIXAS - 1);
+
+    tempo::Histograma h;
+    REQUIRE(tempo::histograma_percentil(h, 0.5) == 0);
+    // 1 a 1000 us em duas threads
+    std::thread t([&h] {
+        for(int i = 1; i <= 1000; i += 2)
+            tempo::histograma_anota(h, i * 1e-6);
+    });
+    for(int i = 2; i <= 1000; i += 2)
+        tempo::histograma_anota(h, i * 1e-6);
+    t.join();
+    REQUIRE(h.n == 1000);
+    REQUIRE(tempo::histograma_max(h) == Approx(1.0).epsilon(0.01));
+    REQUIRE(tempo::histograma_percentil(h, 0.50) == Approx(0.5).epsilon(0.125));
+    REQUIRE(tempo::histograma_percentil(h, 0.95) == Approx(0.95).epsilon(0.125));
+    REQUIRE(tempo::histograma_percentil(h, 0.99) == Approx(0.99).epsilon(0.125));
+    REQUIRE(tempo::histograma_percentil(h, 1.0) <= tempo::histograma_max(h));
+}
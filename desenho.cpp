@@ -0,0 +1,249 @@
+// desenho.cpp
+// Testes do desenho por software (quadro.hpp).
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2023 João Vicente Ferreira Lima, UFSM
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define CATCH_CONFIG_MAIN // O Catch fornece uma main()
+#define CATCH_CONFIG_NO_CPP17_UNCAUGHT_EXCEPTIONS
+#define CATCH_CONFIG_NO_POSIX_SIGNALS
+#include "catch.hpp"
+
+#include <cmath>
+
+#include "quadro.hpp"
+
+using namespace tela;
+
+const uint32_t PRETO = quadro_rgba(0, 0, 0);
+const uint32_t BRANCO = quadro_rgba(255, 255, 255);
+
+// pixels com a cor c
+int conta(const Quadro& q, uint32_t c)
+{
+    int n = 0;
+    for(uint32_t p : q.px)
+        n += (p == c);
+    return n;
+}
+
+TEST_CASE("Cores RGBA") {
+    uint32_t c = quadro_rgba(1, 2, 3, 4);
+    const uint8_t* b = (const uint8_t*)&c;
+    REQUIRE(b[0] == 1);
+    REQUIRE(b[1] == 2);
+    REQUIRE(b[2] == 3);
+    REQUIRE(b[3] == 4);
+}
+
+TEST_CASE("Retangulo pinta os centros dentro dele") {
+    Quadro q;
+    quadro_inicia(q, 40, 30);
+    quadro_retangulo(q, Retangulo{{2, 3}, {10, 5}}, BRANCO);
+    REQUIRE(conta(q, BRANCO) == 50);
+    REQUIRE(quadro_pixel(q, 2, 3) == BRANCO);
+    REQUIRE(quadro_pixel(q, 11, 7) == BRANCO);
+    REQUIRE(quadro_pixel(q, 12, 7) == PRETO);
+    REQUIRE(quadro_pixel(q, 11, 8) == PRETO);
+
+    // meio pixel: so entram os centros
+    quadro_limpa(q, PRETO);
+    quadro_retangulo(q, Retangulo{{0.6f, 0.4f}, {2, 1}}, BRANCO);
+    REQUIRE(conta(q, BRANCO) == 2);
+    REQUIRE(quadro_pixel(q, 1, 0) == BRANCO);
+    REQUIRE(quadro_pixel(q, 2, 0) == BRANCO);
+
+    // cortado nas bordas
+    quadro_limpa(q, PRETO);
+    quadro_retangulo(q, Retangulo{{-10, -10}, {100, 100}}, BRANCO);
+    REQUIRE(conta(q, BRANCO) == 40 * 30);
+}
+
+TEST_CASE("Circulo tem a area certa") {
+    Quadro q;
+    quadro_inicia(q, 200, 200);
+    for(float r : {3.0f, 10.0f, 40.5f}) {
+        quadro_limpa(q, PRETO);
+        quadro_circulo(q, Circulo{{100.3f, 99.7f}, r}, BRANCO);
+        REQUIRE(conta(q, BRANCO) == Approx(M_PI * r * r).epsilon(0.1));
+        // simetrico em torno do centro (a menos de um pixel)
+        REQUIRE(quadro_pixel(q, 100, (int)(99.7f - r + 1)) == BRANCO);
+        REQUIRE(quadro_pixel(q, 100, (int)(99.7f + r - 1)) == BRANCO);
+        REQUIRE(quadro_pixel(q, (int)(100.3f + r + 1), 100) == PRETO);
+    }
+    // fora do quadro nao pinta nem estraga nada
+    quadro_limpa(q, PRETO);
+    quadro_circulo(q, Circulo{{-50, -50}, 20}, BRANCO);
+    REQUIRE(conta(q, BRANCO) == 0);
+}
+
+TEST_CASE("Linha liga as pontas") {
+    Quadro q;
+    quadro_inicia(q, 50, 50);
+    quadro_linha(q, Ponto{5.5f, 5.5f}, Ponto{40.5f, 20.5f}, BRANCO);
+    REQUIRE(quadro_pixel(q, 5, 5) == BRANCO);
+    REQUIRE(quadro_pixel(q, 40, 20) == BRANCO);
+    // um pixel por coluna
+    REQUIRE(conta(q, BRANCO) == 36);
+
+    quadro_limpa(q, PRETO);
+    quadro_linha(q, Ponto{-100, 10.5f}, Ponto{100, 10.5f}, BRANCO);
+    REQUIRE(conta(q, BRANCO) == 50);
+}
+
+TEST_CASE("Fonte do jogo") {
+    Fonte f;
+    REQUIRE(!quadro_fonte(f, "data/nao_existe.tga"));
+    REQUIRE(quadro_fonte(f, "data/fixed_font.tga"));
+    // do espaco ate o fim do ASCII, pelo menos
+    REQUIRE(f.glifos.size() >= 95);
+    REQUIRE(f.alt > 0);
+    REQUIRE(geom::mascara_conta(quadro_glifo(f, ' ')) == 0);
+    REQUIRE(geom::mascara_conta(quadro_glifo(f, '0')) > 0);
+    // fonte de largura fixa
+    REQUIRE(quadro_largura_texto(f, "12") == 2 * quadro_glifo(f, '0').larg);
+    REQUIRE(quadro_largura_texto(f, "") == 0);
+
+    Quadro q;
+    quadro_inicia(q, 100, 40);
+    quadro_texto(q, f, Ponto{3, 2}, "88", BRANCO);
+    Quadro u;
+    quadro_inicia(u, 100, 40);
+    quadro_texto(u, f, Ponto{3, 2}, "8", BRANCO);
+    REQUIRE(conta(q, BRANCO) == 2 * conta(u, BRANCO));
+    // nada fora da caixa do texto
+    for(int y = 0; y < q.alt; y++)
+        for(int x = 0; x < q.larg; x++)
+            if(quadro_pixel(q, x, y) == BRANCO) {
+                REQUIRE(x >= 3);
+                REQUIRE(x < 3 + quadro_largura_texto(f, "88"));
+                REQUIRE(y >= 2);
+                REQUIRE(y < 2 + f.alt);
+            }
+}
+
+// desenha uma cena com um retangulo em r, um circulo em c e uma linha
+void cena(Quadro& q, const Fonte& f, Retangulo r, Circulo c)
+{
+    quadro_limpa(q, PRETO);
+    quadro_retangulo(q, r, BRANCO);
+    quadro_circulo(q, c, quadro_rgba(255, 0, 0));
+    quadro_linha(q, Ponto{0, 0}, Ponto{119, 79}, quadro_rgba(0, 255, 0));
+    quadro_texto(q, f, r.pos, "42", quadro_rgba(0, 0, 255));
+}
+
+TEST_CASE("Corte limita os desenhos") {
+    Quadro q;
+    quadro_inicia(q, 40, 30);
+    quadro_corta(q, 10, 5, 20, 15);
+    quadro_retangulo(q, Retangulo{{0, 0}, {40, 30}}, BRANCO);
+    REQUIRE(conta(q, BRANCO) == 100);
+    REQUIRE(quadro_pixel(q, 10, 5) == BRANCO);
+    REQUIRE(quadro_pixel(q, 20, 5) == PRETO);
+    quadro_limpa(q, PRETO);
+    REQUIRE(conta(q, BRANCO) == 0);
+
+    // o corte fica sempre dentro do quadro
+    quadro_corta(q, -5, -5, 100, 100);
+    quadro_limpa(q, BRANCO);
+    REQUIRE(conta(q, BRANCO) == 40 * 30);
+    quadro_corta(q, 30, 0, 10, 30);
+    REQUIRE(q.x1 == q.x0);
+    quadro_descorta(q);
+    REQUIRE(q.x0 == 0);
+    REQUIRE(q.x1 == 40);
+}
+
+TEST_CASE("Redesenhar so as regioes sujas da o mesmo quadro") {
+    Fonte f;
+    REQUIRE(quadro_fonte(f, "data/fixed_font.tga"));
+    Retangulo r0{{10.5f, 20}, {20, 20}}, r1{{14, 22.5f}, {20, 20}};
+    Circulo c0{{80, 30}, 6}, c1{{80.5f, 22}, 6};
+
+    Quadro todo, parte;
+    quadro_inicia(todo, 120, 80);
+    quadro_inicia(parte, 120, 80);
+    cena(todo, f, r1, c1);
+    cena(parte, f, r0, c0);
+
+    // regioes com um pixel de folga, como Tela::suja
+    auto regiao = [](Retangulo r) {
+        return Retangulo{{std::floor(r.pos.x) - 1, std::floor(r.pos.y) - 1},
+                         {std::ceil(r.tam.larg) + 3, std::ceil(r.tam.alt) + 3}};
+    };
+    for(Retangulo s : {uniao(regiao(r0), regiao(r1)),
+                       uniao(regiao(geom::caixa(c0)), regiao(geom::caixa(c1)))}) {
+        quadro_corta(parte, s.pos.x, s.pos.y, s.pos.x + s.tam.larg, s.pos.y + s.tam.alt);
+        cena(parte, f, r1, c1);
+    }
+    quadro_descorta(parte);
+    REQUIRE(parte.px == todo.px);
+}
+
+TEST_CASE("Captura em PPM e comparacao") {
+    Fonte f;
+    REQUIRE(quadro_fonte(f, "data/fixed_font.tga"));
+    Quadro q;
+    quadro_inicia(q, 120, 80);
+    cena(q, f, Retangulo{{10, 20}, {20, 20}}, Circulo{{80, 30}, 6});
+
+    const char* nome = "desenho_teste.ppm";
+    REQUIRE(quadro_grava_ppm(q, nome));
+    Quadro lido;
+    REQUIRE(quadro_le_ppm(nome, lido));
+    std::remove(nome);
+    REQUIRE(lido.larg == 120);
+    REQUIRE(lido.alt == 80);
+    REQUIRE(lido.px == q.px);
+    REQUIRE(!quadro_le_ppm("data/nao_existe.ppm", lido));
+    REQUIRE(!quadro_le_ppm("data/fixed_font.tga", lido));
+    // cabecalhos fora da faixa sao recusados antes de alocar
+    const char* ruins[] = {"P6 40000 2 255\n", "P6 2 99999999999999 255\n",
+                           "P6 0 2 255\n", "P6 2 2 65535\n"};
+    for (const char* cab : ruins) {
+        FILE* f = std::fopen(nome, "wb");
+        REQUIRE(f != nullptr);
+        std::fputs(cab, f);
+        std::fclose(f);
+        CHECK(!quadro_le_ppm(nome, lido));
+    }
+    std::remove(nome);
+
+    // igual a si mesmo; um pixel um pouco mais claro so conta sem tolerancia
+    QuadroDiferenca d = quadro_compara(q, lido);
+    REQUIRE(d.pixels == 0);
+    REQUIRE(d.maior == 0);
+    REQUIRE(quadro_pixel(q, 119, 0) == PRETO);
+    REQUIRE(quadro_pixel(q, 118, 0) == PRETO);
+    lido.px[119] = quadro_rgba(0, 5, 0);
+    lido.px[118] = BRANCO;
+    d = quadro_compara(q, lido);
+    REQUIRE(d.pixels == 2);
+    REQUIRE(d.maior == 255);
+    REQUIRE(quadro_compara(q, lido, 5).pixels == 1);
+    REQUIRE(quadro_compara(q, lido, 255).pixels == 0);
+
+    Quadro menor;
+    quadro_inicia(menor, 60, 80);
+    REQUIRE(quadro_compara(q, menor).pixels == -1);
+}
@@ -0,0 +1,393 @@
+// fixo.hpp
+// Geometria em ponto fixo 16.16: os mesmos tipos e predicados de geom.hpp
+// com inteiros, para que os resultados sejam identicos em qualquer
+// compilador, otimizacao ou maquina (replay e jogo em rede em lockstep).
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2023 João Vicente Ferreira Lima, UFSM
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <compare>
+#include <cstdint>
+#include <vector>
+
+#include "geom.hpp"
+
+namespace geom {
+namespace fixo {
+
+// Numero com 16 bits de parte inteira e 16 de fracao (v = valor * 65536).
+// Cobre de -32768 a 32767 com passo de 1/65536, o que sobra para o campo de
+// jogo. Soma e subtracao sao exatas; multiplicacao arredonda para baixo e
+// divisao para zero, sempre do mesmo jeito.
+struct Fixo {
+    int32_t v;
+
+    constexpr Fixo() : v(0) {}
+    // i de -32768 a 32767; fora disso o assert falha (e, em uma expressao
+    // constante, nao compila)
+    constexpr Fixo(int i) : v(int32_t(int64_t(i) * 65536)) {
+        assert(i >= -32768 && i <= 32767);
+    }
+    // arredonda para o mais proximo; f * 65536 e exato em float. Mesma
+    // faixa de Fixo(int), ate 32767 + 65535/65536.
+    constexpr Fixo(float f) : v(0) {
+        assert(f >= -32768.0f && f < 32768.0f);
+        v = int32_t(f * 65536.0f + (f < 0 ? -0.5f : 0.5f));
+    }
+
+    static constexpr Fixo bruto(int32_t v) {
+        Fixo f;
+        f.v = v;
+        return f;
+    }
+
+    constexpr auto operator<=>(const Fixo&) const = default;
+};
+
+constexpr Fixo operator+(Fixo a, Fixo b) { return Fixo::bruto(a.v + b.v); }
+constexpr Fixo operator-(Fixo a, Fixo b) { return Fixo::bruto(a.v - b.v); }
+constexpr Fixo operator-(Fixo a) { return Fixo::bruto(-a.v); }
+constexpr Fixo operator*(Fixo a, Fixo b) {
+    return Fixo::bruto(int32_t((int64_t(a.v) * b.v) >> 16));
+}
+constexpr Fixo operator/(Fixo a, Fixo b) {
+    return Fixo::bruto(int32_t(int64_t(a.v) * 65536 / b.v));
+}
+constexpr Fixo& operator+=(Fixo& a, Fixo b) { return a = a + b; }
+constexpr Fixo& operator-=(Fixo& a, Fixo b) { return a = a - b; }
+
+// valor em float (para desenhar; nao use o resultado na simulacao)
+constexpr float real(Fixo f) { return f.v / 65536.0f; }
+
+// raiz quadrada inteira (arredondada para baixo)
+constexpr uint64_t raiz(uint64_t n) {
+    uint64_t r = 0, bit = uint64_t(1) << 62;
+    while (bit > n)
+        bit >>= 2;
+    while (bit != 0) {
+        if (n >= r + bit) {
+            n -= r + bit;
+            r = (r >> 1) + bit;
+        } else
+            r >>= 1;
+        bit >>= 2;
+    }
+    return r;
+}
+
+struct Ponto {
+    Fixo x;
+    Fixo y;
+};
+
+struct Tamanho {
+    Fixo larg;
+    Fixo alt;
+};
+
+struct Retangulo {
+    Ponto pos;
+    Tamanho tam;
+};
+
+struct Circulo {
+    Ponto centro;
+    Fixo raio;
+};
+
+// conversao dos tipos em float
+constexpr Ponto converte(geom::Ponto p) { return {p.x, p.y}; }
+constexpr Retangulo converte(geom::Retangulo r) {
+    return {{r.pos.x, r.pos.y}, {r.tam.larg, r.tam.alt}};
+}
+constexpr Circulo converte(geom::Circulo c) { return {converte(c.centro), c.raio}; }
+
+// Predicados, com a mesma semantica dos de geom.hpp. Distancias ao
+// quadrado ficam em 64 bits (32.32) e sao exatas.
+
+constexpr int64_t distancia2(Ponto p1, Ponto p2) {
+    int64_t dx = p2.x.v - p1.x.v, dy = p2.y.v - p1.y.v;
+    return dx * dx + dy * dy;
+}
+
+constexpr int64_t quadrado(Fixo f) { return int64_t(f.v) * f.v; }
+
+constexpr bool ptemcirc(Ponto p, Circulo c) {
+    return distancia2(p, c.centro) <= quadrado(c.raio);
+}
+
+constexpr bool ptemret(Ponto p, Retangulo r) {
+    return (r.pos.x < p.x && r.pos.x + r.tam.larg > p.x && r.pos.y < p.y &&
+            r.pos.y + r.tam.alt > p.y);
+}
+
+constexpr Ponto maisproximo(Ponto p, Retangulo r) {
+    Ponto q = p;
+    if (p.x < r.pos.x)
+        q.x = r.pos.x;
+    else if (p.x > r.pos.x + r.tam.larg)
+        q.x = r.pos.x + r.tam.larg;
+    if (p.y < r.pos.y)
+        q.y = r.pos.y;
+    else if (p.y > r.pos.y + r.tam.alt)
+        q.y = r.pos.y + r.tam.alt;
+    return q;
+}
+
+constexpr bool intercr(Circulo c, Retangulo r) {
+    return distancia2(c.centro, maisproximo(c.centro, r)) < quadrado(c.raio);
+}
+
+constexpr bool interrr(Retangulo r1, Retangulo r2) {
+    return r1.pos.x < r2.pos.x + r2.tam.larg &&
+           r1.pos.x + r1.tam.larg > r2.pos.x &&
+           r1.pos.y < r2.pos.y + r2.tam.alt &&
+           r1.pos.y + r1.tam.alt > r2.pos.y;
+}
+
+constexpr bool intercc(Circulo c1, Circulo c2) {
+    return distancia2(c1.centro, c2.centro) <= quadrado(c1.raio + c2.raio);
+}
+
+// Mesmo calculo de geom::tempo_impacto, com a raiz inteira. Retorna -1 se
+// nao tocar. Os produtos do canto ficam em 64 bits enquanto as distancias
+// envolvidas forem menores que uns 180 pixels.
+constexpr Fixo tempo_impacto(Circulo c, Ponto d, Retangulo r) {
+    if (intercr(c, r))
+        return 0;
+    if (d.x == 0 && d.y == 0)
+        return -1;
+
+    Ponto p = c.centro;
+    Fixo ex0 = r.pos.x - c.raio, ex1 = r.pos.x + r.tam.larg + c.raio;
+    Fixo ey0 = r.pos.y - c.raio, ey1 = r.pos.y + r.tam.alt + c.raio;
+
+    Fixo t0 = 0, t1 = 1;
+    if (d.x == 0) {
+        if (p.x <= ex0 || p.x >= ex1)
+            return -1;
+    } else {
+        Fixo a = (ex0 - p.x) / d.x, b = (ex1 - p.x) / d.x;
+        if (a > b)
+            std::swap(a, b);
+        t0 = std::max(t0, a);
+        t1 = std::min(t1, b);
+    }
+    if (d.y == 0) {
+        if (p.y <= ey0 || p.y >= ey1)
+            return -1;
+    } else {
+        Fixo a = (ey0 - p.y) / d.y, b = (ey1 - p.y) / d.y;
+        if (a > b)
+            std::swap(a, b);
+        t0 = std::max(t0, a);
+        t1 = std::min(t1, b);
+    }
+    if (t0 > t1)
+        return -1;
+
+    Ponto q{p.x + t0 * d.x, p.y + t0 * d.y};
+    bool fora_x = q.x < r.pos.x || q.x > r.pos.x + r.tam.larg;
+    bool fora_y = q.y < r.pos.y || q.y > r.pos.y + r.tam.alt;
+    if (!fora_x || !fora_y)
+        return t0;
+
+    Ponto k = maisproximo(q, r);
+    Fixo mx = p.x - k.x, my = p.y - k.y;
+    Fixo a = d.x * d.x + d.y * d.y;
+    Fixo b = mx * d.x + my * d.y;
+    Fixo e = mx * mx + my * my - c.raio * c.raio;
+    int64_t delta = quadrado(b) - int64_t(a.v) * e.v;
+    if (delta < 0 || a == 0)
+        return -1;
+    Fixo s = Fixo::bruto(int32_t(raiz(uint64_t(delta))));
+    Fixo t = (-b - s) / a;
+    return (t >= 0 && t <= 1) ? t : Fixo(-1);
+}
+
+// Testes em lote, como os de geom.hpp, com os valores brutos em int32. As
+// comparacoes sao inteiras, entao o SIMD e o escalar concordam por
+// construcao.
+
+struct LoteRetangulos {
+    std::vector<int32_t> x;
+    std::vector<int32_t> y;
+    std::vector<int32_t> larg;
+    std::vector<int32_t> alt;
+};
+
+inline void lote_limpa(LoteRetangulos& l) {
+    l.x.clear();
+    l.y.clear();
+    l.larg.clear();
+    l.alt.clear();
+}
+
+inline int lote_insere(LoteRetangulos& l, Retangulo r) {
+    l.x.push_back(r.pos.x.v);
+    l.y.push_back(r.pos.y.v);
+    l.larg.push_back(r.tam.larg.v);
+    l.alt.push_back(r.tam.alt.v);
+    return l.x.size() - 1;
+}
+
+inline int lote_insere(LoteRetangulos& l, geom::Retangulo r) {
+    return lote_insere(l, converte(r));
+}
+
+inline int lote_tamanho(const LoteRetangulos& l) {
+    return l.x.size();
+}
+
+inline Retangulo lote_retangulo(const LoteRetangulos& l, int i) {
+    return {{Fixo::bruto(l.x[i]), Fixo::bruto(l.y[i])},
+            {Fixo::bruto(l.larg[i]), Fixo::bruto(l.alt[i])}};
+}
+
+inline bool intercr_lote_um(Circulo c, const LoteRetangulos& l, int i) {
+    return intercr(c, lote_retangulo(l, i));
+}
+
+inline bool interrr_lote_um(Retangulo r, const LoteRetangulos& l, int i) {
+    return interrr(r, lote_retangulo(l, i));
+}
+
+inline bool interrr_lote_um(geom::Retangulo r, const LoteRetangulos& l, int i) {
+    return interrr(converte(r), lote_retangulo(l, i));
+}
+
+inline void intercr_lote_escalar(Circulo c, const LoteRetangulos& l,
+                                 std::vector<uint64_t>& mascara) {
+    int n = lote_tamanho(l);
+    mascara.assign((n + 63) / 64, 0);
+    for (int i = 0; i < n; i++)
+        if (intercr_lote_um(c, l, i))
+            mascara[i / 64] |= uint64_t(1) << (i % 64);
+}
+
+inline void interrr_lote_escalar(Retangulo r, const LoteRetangulos& l,
+                                 std::vector<uint64_t>& mascara) {
+    int n = lote_tamanho(l);
+    mascara.assign((n + 63) / 64, 0);
+    for (int i = 0; i < n; i++)
+        if (interrr_lote_um(r, l, i))
+            mascara[i / 64] |= uint64_t(1) << (i % 64);
+}
+
+#if defined(__AVX2__)
+constexpr int LOTE_LARGURA = 8;
+#elif defined(__SSE2__)
+constexpr int LOTE_LARGURA = 4;
+#else
+constexpr int LOTE_LARGURA = 1;
+#endif
+
+#if defined(__AVX2__)
+// bits 0..3 de b nas posicoes pares 0, 2, 4, 6
+inline uint64_t espalha4(int b) {
+    return (b & 1) | (b & 2) << 1 | (b & 4) << 2 | (b & 8) << 3;
+}
+#endif
+
+// testa o circulo c contra todos os retangulos do lote. As distancias ao
+// quadrado precisam de 64 bits, entao o SIMD so existe com AVX2
+// (multiplicacao 32x32->64 e comparacao de 64 bits).
+inline void intercr_lote(Circulo c, const LoteRetangulos& l,
+                         std::vector<uint64_t>& mascara) {
+    int n = lote_tamanho(l);
+    mascara.assign((n + 63) / 64, 0);
+    int i = 0;
+#if defined(__AVX2__)
+    const __m256i cx = _mm256_set1_epi32(c.centro.x.v);
+    const __m256i cy = _mm256_set1_epi32(c.centro.y.v);
+    const __m256i r2 = _mm256_set1_epi64x(quadrado(c.raio));
+    for (; i + 8 <= n; i += 8) {
+        __m256i x0 = _mm256_loadu_si256((const __m256i*)&l.x[i]);
+        __m256i y0 = _mm256_loadu_si256((const __m256i*)&l.y[i]);
+        __m256i x1 = _mm256_add_epi32(x0, _mm256_loadu_si256((const __m256i*)&l.larg[i]));
+        __m256i y1 = _mm256_add_epi32(y0, _mm256_loadu_si256((const __m256i*)&l.alt[i]));
+        __m256i dx = _mm256_sub_epi32(cx, _mm256_max_epi32(x0, _mm256_min_epi32(cx, x1)));
+        __m256i dy = _mm256_sub_epi32(cy, _mm256_max_epi32(y0, _mm256_min_epi32(cy, y1)));
+        // posicoes pares e impares separadas, em 64 bits
+        __m256i d2p = _mm256_add_epi64(_mm256_mul_epi32(dx, dx), _mm256_mul_epi32(dy, dy));
+        __m256i dxi = _mm256_srli_epi64(dx, 32), dyi = _mm256_srli_epi64(dy, 32);
+        __m256i d2i = _mm256_add_epi64(_mm256_mul_epi32(dxi, dxi), _mm256_mul_epi32(dyi, dyi));
+        int mp = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(r2, d2p)));
+        int mi = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(r2, d2i)));
+        uint64_t m = espalha4(mp) | espalha4(mi) << 1;
+        mascara[i / 64] |= m << (i % 64);
+    }
+#endif
+    for (; i < n; i++)
+        if (intercr_lote_um(c, l, i))
+            mascara[i / 64] |= uint64_t(1) << (i % 64);
+}
+
+// testa o retangulo r contra todos os retangulos do lote
+inline void interrr_lote(Retangulo r, const LoteRetangulos& l,
+                         std::vector<uint64_t>& mascara) {
+    int n = lote_tamanho(l);
+    mascara.assign((n + 63) / 64, 0);
+    int i = 0;
+#if defined(__AVX2__)
+    const __m256i rx0 = _mm256_set1_epi32(r.pos.x.v);
+    const __m256i ry0 = _mm256_set1_epi32(r.pos.y.v);
+    const __m256i rx1 = _mm256_set1_epi32((r.pos.x + r.tam.larg).v);
+    const __m256i ry1 = _mm256_set1_epi32((r.pos.y + r.tam.alt).v);
+    for (; i + 8 <= n; i += 8) {
+        __m256i x0 = _mm256_loadu_si256((const __m256i*)&l.x[i]);
+        __m256i y0 = _mm256_loadu_si256((const __m256i*)&l.y[i]);
+        __m256i x1 = _mm256_add_epi32(x0, _mm256_loadu_si256((const __m256i*)&l.larg[i]));
+        __m256i y1 = _mm256_add_epi32(y0, _mm256_loadu_si256((const __m256i*)&l.alt[i]));
+        __m256i h = _mm256_and_si256(_mm256_cmpgt_epi32(x1, rx0), _mm256_cmpgt_epi32(rx1, x0));
+        __m256i v = _mm256_and_si256(_mm256_cmpgt_epi32(y1, ry0), _mm256_cmpgt_epi32(ry1, y0));
+        uint64_t m = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_and_si256(h, v)));
+        mascara[i / 64] |= m << (i % 64);
+    }
+#elif defined(__SSE2__)
+    const __m128i rx0 = _mm_set1_epi32(r.pos.x.v);
+    const __m128i ry0 = _mm_set1_epi32(r.pos.y.v);
+    const __m128i rx1 = _mm_set1_epi32((r.pos.x + r.tam.larg).v);
+    const __m128i ry1 = _mm_set1_epi32((r.pos.y + r.tam.alt).v);
+    for (; i + 4 <= n; i += 4) {
+        __m128i x0 = _mm_loadu_si128((const __m128i*)&l.x[i]);
+        __m128i y0 = _mm_loadu_si128((const __m128i*)&l.y[i]);
+        __m128i x1 = _mm_add_epi32(x0, _mm_loadu_si128((const __m128i*)&l.larg[i]));
+        __m128i y1 = _mm_add_epi32(y0, _mm_loadu_si128((const __m128i*)&l.alt[i]));
+        __m128i h = _mm_and_si128(_mm_cmpgt_epi32(x1, rx0), _mm_cmpgt_epi32(rx1, x0));
+        __m128i v = _mm_and_si128(_mm_cmpgt_epi32(y1, ry0), _mm_cmpgt_epi32(ry1, y0));
+        uint64_t m = _mm_movemask_ps(_mm_castsi128_ps(_mm_and_si128(h, v)));
+        mascara[i / 64] |= m << (i % 64);
+    }
+#endif
+    for (; i < n; i++)
+        if (interrr_lote_um(r, l, i))
+            mascara[i / 64] |= uint64_t(1) << (i % 64);
+}
+
+}; // namespace fixo
+}; // namespace geom
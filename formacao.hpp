@@ -0,0 +1,84 @@
+// formacao.hpp
+// Posicoes das vagas da formacao de invaders, calculadas em tempo de
+// compilacao.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2023 João Vicente Ferreira Lima, UFSM
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <array>
+
+#include "geom.hpp"
+
+namespace geom {
+
+const int FORMACAO_LARGURA = 600; // largura dividida pela arvore
+const int FORMACAO_LINHA = 30;    // distancia entre os niveis
+const int FORMACAO_INVADER = 20;  // lado de um invader
+const int FORMACAO_NIVEIS = 10;   // niveis que cabem na tabela
+
+// A vaga de um no da Abb e o seu indice de heap: a raiz e a vaga 1 e os
+// filhos da vaga v sao 2v (esquerdo) e 2v+1 (direito). Cada nivel divide ao
+// meio a faixa [x0, x1] do pai, com a mesma divisao inteira que o
+// move_arvore fazia a cada quadro. Retorna o canto do invader, relativo ao
+// ponto de referencia da formacao.
+constexpr Ponto formacao_calcula(unsigned vaga) noexcept {
+    int nivel = 0;
+    while ((vaga >> (nivel + 1)) != 0)
+        nivel++;
+    int x0 = 0, x1 = FORMACAO_LARGURA;
+    for (int b = nivel - 1; b >= 0; b--) {
+        int meio = x0 + (x1 - x0) / 2;
+        if ((vaga >> b) & 1)
+            x0 = meio;
+        else
+            x1 = meio;
+    }
+    return Ponto{float(x0 + (x1 - x0) / 2 - FORMACAO_INVADER / 2),
+                 float(nivel * FORMACAO_LINHA)};
+}
+
+template <int N>
+constexpr std::array<Ponto, N> formacao_tabela() noexcept {
+    std::array<Ponto, N> t{};
+    for (int v = 1; v < N; v++)
+        t[v] = formacao_calcula(v);
+    return t;
+}
+
+// vagas 1 a 2^FORMACAO_NIVEIS - 1 (a posicao 0 nao e usada)
+inline constexpr std::array<Ponto, (1 << FORMACAO_NIVEIS)> FORMACAO_VAGAS =
+    formacao_tabela<(1 << FORMACAO_NIVEIS)>();
+
+// posicao da vaga; arvores mais altas que a tabela calculam na hora
+constexpr Ponto formacao_vaga(unsigned vaga) noexcept {
+    return (vaga < FORMACAO_VAGAS.size()) ? FORMACAO_VAGAS[vaga] : formacao_calcula(vaga);
+}
+
+// caixa do invader na vaga, relativa ao ponto de referencia da formacao
+constexpr Retangulo formacao_caixa(unsigned vaga) noexcept {
+    return Retangulo{formacao_vaga(vaga), {FORMACAO_INVADER, FORMACAO_INVADER}};
+}
+
+}; // namespace geom
@@ -27,7 +27,17 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 namespace geom {
 
@@ -57,78 +67,375 @@ struct Circulo {
 };
 
 // Funções
+//
+// Os testes com circulos comparam distancias ao quadrado, entao nao usam
+// raiz quadrada nem outras funcoes da libm.
+// Todas as funcoes ate os testes em lote sao constexpr, entao tabelas de
+// posicoes e caixas podem ser calculadas em tempo de compilacao.
+
+// retorna o quadrado da distancia entre dois pontos
+constexpr float distancia2(Ponto p1, Ponto p2) noexcept {
+    return (p2.x - p1.x) * (p2.x - p1.x) + (p2.y - p1.y) * (p2.y - p1.y);
+}
+
+// Raiz quadrada que tambem funciona em tempo de compilacao (std::sqrt nao
+// e constexpr). Em tempo de execucao e std::sqrt; em tempo de compilacao e
+// o metodo de Newton em double, que pode diferir do std::sqrt no ultimo
+// bit do float.
+constexpr float raiz_quadrada(float x) noexcept {
+    if (!std::is_constant_evaluated())
+        return std::sqrt(x);
+    if (!(x > 0))
+        return x == 0 ? 0 : std::numeric_limits<float>::quiet_NaN();
+    double r = (x > 1) ? x : 1;
+    for (;;) {
+        double s = (r + x / r) / 2;
+        if (s >= r)
+            return float(r);
+        r = s;
+    }
+}
 
 // retorna a distancia entre dois pontos
-inline float distancia(Ponto p1, Ponto p2) {
-    return std::sqrt(std::pow((p2.x - p1.x), 2) + std::pow((p2.y - p1.y), 2));
+constexpr float distancia(Ponto p1, Ponto p2) noexcept {
+    return raiz_quadrada(distancia2(p1, p2));
 }
 
 // retorna true se o ponto estiver dentro do circulo, false caso contrario
-inline bool ptemcirc(Ponto p, Circulo c) {
-    if (distancia(p, c.centro) > c.raio)
-        return false;
-    else
-        return true;
+constexpr bool ptemcirc(Ponto p, Circulo c) noexcept {
+    return distancia2(p, c.centro) <= c.raio * c.raio;
 }
 
 // retorna true se o ponto estiver dentro do retangulo
-inline bool ptemret(Ponto p, Retangulo r) {
+constexpr bool ptemret(Ponto p, Retangulo r) noexcept {
     return (r.pos.x < p.x && r.pos.x + r.tam.larg > p.x && r.pos.y < p.y &&
             r.pos.y + r.tam.alt > p.y);
-    if ((p.x <= r.pos.x + r.tam.larg) && (p.y <= r.pos.y + r.tam.alt))
-        return true;
-    else
-        return false;
+}
+
+// retorna o ponto do retangulo mais proximo de p
+constexpr Ponto maisproximo(Ponto p, Retangulo r) noexcept {
+    Ponto q = p;
+    if (p.x < r.pos.x)
+        q.x = r.pos.x;
+    else if (p.x > r.pos.x + r.tam.larg)
+        q.x = r.pos.x + r.tam.larg;
+    if (p.y < r.pos.y)
+        q.y = r.pos.y;
+    else if (p.y > r.pos.y + r.tam.alt)
+        q.y = r.pos.y + r.tam.alt;
+    return q;
+}
+
+// retorna o menor retangulo que contem o circulo
+constexpr Retangulo caixa(Circulo c) noexcept {
+    return Retangulo{{c.centro.x - c.raio, c.centro.y - c.raio},
+                     {2 * c.raio, 2 * c.raio}};
 }
 
 // retorna true se houver uma interseccao entre o circulo e o retangulo
-inline bool intercr(Circulo c, Retangulo r) {
-    Ponto lim;
-    if (ptemret(c.centro, r))
-        return true;
-    else {
-        if (c.centro.x < r.pos.x)
-            lim.x = r.pos.x - c.centro.x;
-        else if (c.centro.x > r.pos.x + r.tam.larg)
-            lim.x = c.centro.x - (r.pos.x + r.tam.larg);
-        else
-            lim.x = 0;
-
-        if (c.centro.y < r.pos.y)
-            lim.y = r.pos.y - c.centro.y;
-        else if (c.centro.y > r.pos.y + r.tam.alt)
-            lim.y = c.centro.y - (r.pos.y + r.tam.alt);
-        else
-            lim.y = 0;
-
-        if (distancia(c.centro, lim) < c.raio)
-            return true;
-        else
-            return false;
-    }
+constexpr bool intercr(Circulo c, Retangulo r) noexcept {
+    return distancia2(c.centro, maisproximo(c.centro, r)) < c.raio * c.raio;
 }
 
 // retorna true se houver uma interseccao entre os dois retangulos
-inline bool interrr(Retangulo r1, Retangulo r2) {
-    Ponto _r1, _r2;
-    _r1.x = r1.pos.x + r1.tam.larg;
-    _r1.y = r1.pos.y + r1.tam.alt;
-    _r2.x = r2.pos.x + r2.tam.larg;
-    _r2.y = r2.pos.y + r2.tam.alt;
+constexpr bool interrr(Retangulo r1, Retangulo r2) noexcept {
+    return r1.pos.x < r2.pos.x + r2.tam.larg &&
+           r1.pos.x + r1.tam.larg > r2.pos.x &&
+           r1.pos.y < r2.pos.y + r2.tam.alt &&
+           r1.pos.y + r1.tam.alt > r2.pos.y;
+}
 
-    if (ptemret(r1.pos, r2) || ptemret(r2.pos, r1) || ptemret(_r1, r2) ||
-        ptemret(_r2, r1))
-        return true;
-    else
-        return false;
+// retorna o menor retangulo que contem a e b
+constexpr Retangulo uniao(Retangulo a, Retangulo b) noexcept {
+    float x0 = std::min(a.pos.x, b.pos.x), y0 = std::min(a.pos.y, b.pos.y);
+    float x1 = std::max(a.pos.x + a.tam.larg, b.pos.x + b.tam.larg);
+    float y1 = std::max(a.pos.y + a.tam.alt, b.pos.y + b.tam.alt);
+    return Retangulo{{x0, y0}, {x1 - x0, y1 - y0}};
 }
 
 // retorna true se houver uma interseccao entre os dois circulos
-inline bool intercc(Circulo c1, Circulo c2) {
-    if (distancia(c1.centro, c2.centro) > c1.raio + c2.raio)
-        return true;
-    else
-        return false;
+constexpr bool intercc(Circulo c1, Circulo c2) noexcept {
+    return distancia2(c1.centro, c2.centro) <=
+           (c1.raio + c2.raio) * (c1.raio + c2.raio);
+}
+
+// Testes com movimento
+//
+// Um circulo que anda d em um passo ocupa, no instante t (0 a 1), o circulo
+// com centro c.centro + t*d. As funcoes abaixo acham o primeiro instante em
+// que ele toca um retangulo, para que objetos rapidos nao atravessem
+// objetos finos entre um passo e outro.
+
+// retorna o menor retangulo que contem o circulo durante todo o passo d
+constexpr Retangulo caixa_varrida(Circulo c, Ponto d) noexcept {
+    Retangulo r = caixa(c);
+    if (d.x < 0)
+        r.pos.x += d.x;
+    if (d.y < 0)
+        r.pos.y += d.y;
+    r.tam.larg += (d.x < 0) ? -d.x : d.x;
+    r.tam.alt += (d.y < 0) ? -d.y : d.y;
+    return r;
+}
+
+// Instante (0 a 1) em que o circulo c, andando d, toca o retangulo r pela
+// primeira vez, ou -1 se nao tocar durante o passo. Retorna 0 se ja comeca
+// tocando. O centro do circulo toca o retangulo aumentado de c.raio com
+// cantos arredondados: primeiro testa o retangulo aumentado (faces) e, se a
+// entrada cair na regiao de um canto, o circulo daquele canto.
+constexpr float tempo_impacto(Circulo c, Ponto d, Retangulo r) noexcept {
+    if (intercr(c, r))
+        return 0;
+    if (d.x == 0 && d.y == 0)
+        return -1;
+
+    Ponto p = c.centro;
+    float ex0 = r.pos.x - c.raio, ex1 = r.pos.x + r.tam.larg + c.raio;
+    float ey0 = r.pos.y - c.raio, ey1 = r.pos.y + r.tam.alt + c.raio;
+
+    // entrada e saida do segmento nas duas faixas do retangulo aumentado
+    float t0 = 0, t1 = 1;
+    if (d.x == 0) {
+        if (p.x <= ex0 || p.x >= ex1)
+            return -1;
+    } else {
+        float a = (ex0 - p.x) / d.x, b = (ex1 - p.x) / d.x;
+        if (a > b)
+            std::swap(a, b);
+        t0 = std::max(t0, a);
+        t1 = std::min(t1, b);
+    }
+    if (d.y == 0) {
+        if (p.y <= ey0 || p.y >= ey1)
+            return -1;
+    } else {
+        float a = (ey0 - p.y) / d.y, b = (ey1 - p.y) / d.y;
+        if (a > b)
+            std::swap(a, b);
+        t0 = std::max(t0, a);
+        t1 = std::min(t1, b);
+    }
+    if (t0 > t1)
+        return -1;
+
+    // entrou por uma face?
+    Ponto q{p.x + t0 * d.x, p.y + t0 * d.y};
+    bool fora_x = q.x < r.pos.x || q.x > r.pos.x + r.tam.larg;
+    bool fora_y = q.y < r.pos.y || q.y > r.pos.y + r.tam.alt;
+    if (!fora_x || !fora_y)
+        return t0;
+
+    // regiao de canto: |p + t*d - k|^2 = raio^2
+    Ponto k = maisproximo(q, r);
+    float mx = p.x - k.x, my = p.y - k.y;
+    float a = d.x * d.x + d.y * d.y;
+    float b = mx * d.x + my * d.y;
+    float e = mx * mx + my * my - c.raio * c.raio;
+    float delta = b * b - a * e;
+    if (delta < 0)
+        return -1;
+    float t = (-b - raiz_quadrada(delta)) / a;
+    return (t >= 0 && t <= 1) ? t : -1;
+}
+
+// Instante t >= 0 em que o raio o + t*d entra no retangulo r, ou -1 se nao
+// entrar antes de tmax. Retorna 0 se o ja esta dentro.
+constexpr float tempo_raio(Ponto o, Ponto d, Retangulo r, float tmax) noexcept {
+    float t0 = 0, t1 = tmax;
+    float lo[2] = {r.pos.x, r.pos.y};
+    float hi[2] = {r.pos.x + r.tam.larg, r.pos.y + r.tam.alt};
+    float p[2] = {o.x, o.y}, v[2] = {d.x, d.y};
+    for (int e = 0; e < 2; e++) {
+        if (v[e] == 0) {
+            if (p[e] < lo[e] || p[e] > hi[e])
+                return -1;
+            continue;
+        }
+        float a = (lo[e] - p[e]) / v[e], z = (hi[e] - p[e]) / v[e];
+        if (a > z)
+            std::swap(a, z);
+        t0 = std::max(t0, a);
+        t1 = std::min(t1, z);
+        if (t0 > t1)
+            return -1;
+    }
+    return t0;
+}
+
+// Testes em lote
+//
+// Um lote guarda retangulos como estrutura de vetores (x, y, larg, alt em
+// vetores separados) para que as funcoes abaixo testem uma figura contra
+// varios retangulos por instrucao (8 com AVX, 4 com SSE). O resultado e uma
+// mascara com um bit por retangulo: bit i da palavra i/64 ligado se houver
+// interseccao com o retangulo i. As versoes _escalar fazem as mesmas
+// operacoes na mesma ordem e dao exatamente o mesmo resultado.
+
+struct LoteRetangulos {
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> larg;
+    std::vector<float> alt;
+};
+
+inline void lote_limpa(LoteRetangulos& l) {
+    l.x.clear();
+    l.y.clear();
+    l.larg.clear();
+    l.alt.clear();
+}
+
+// insere r no fim do lote e retorna seu indice
+inline int lote_insere(LoteRetangulos& l, Retangulo r) {
+    l.x.push_back(r.pos.x);
+    l.y.push_back(r.pos.y);
+    l.larg.push_back(r.tam.larg);
+    l.alt.push_back(r.tam.alt);
+    return l.x.size() - 1;
+}
+
+inline int lote_tamanho(const LoteRetangulos& l) {
+    return l.x.size();
+}
+
+inline Retangulo lote_retangulo(const LoteRetangulos& l, int i) {
+    return Retangulo{{l.x[i], l.y[i]}, {l.larg[i], l.alt[i]}};
+}
+
+// min/max com a mesma semantica de _mm_min_ps/_mm_max_ps
+constexpr float min_lote(float a, float b) noexcept {
+    return (a < b) ? a : b;
+}
+constexpr float max_lote(float a, float b) noexcept {
+    return (a > b) ? a : b;
+}
+
+// circulo contra o retangulo i do lote: ponto do retangulo mais proximo do
+// centro a menos de um raio
+inline bool intercr_lote_um(Circulo c, const LoteRetangulos& l, int i) {
+    float px = max_lote(l.x[i], min_lote(c.centro.x, l.x[i] + l.larg[i]));
+    float py = max_lote(l.y[i], min_lote(c.centro.y, l.y[i] + l.alt[i]));
+    float dx = c.centro.x - px;
+    float dy = c.centro.y - py;
+    return (dx * dx + dy * dy) < (c.raio * c.raio);
+}
+
+// retangulo contra o retangulo i do lote (sobreposicao estrita)
+inline bool interrr_lote_um(Retangulo r, const LoteRetangulos& l, int i) {
+    return r.pos.x < l.x[i] + l.larg[i] && r.pos.x + r.tam.larg > l.x[i] &&
+           r.pos.y < l.y[i] + l.alt[i] && r.pos.y + r.tam.alt > l.y[i];
+}
+
+inline void intercr_lote_escalar(Circulo c, const LoteRetangulos& l,
+                                 std::vector<uint64_t>& mascara) {
+    int n = lote_tamanho(l);
+    mascara.assign((n + 63) / 64, 0);
+    for (int i = 0; i < n; i++)
+        if (intercr_lote_um(c, l, i))
+            mascara[i / 64] |= uint64_t(1) << (i % 64);
+}
+
+inline void interrr_lote_escalar(Retangulo r, const LoteRetangulos& l,
+                                 std::vector<uint64_t>& mascara) {
+    int n = lote_tamanho(l);
+    mascara.assign((n + 63) / 64, 0);
+    for (int i = 0; i < n; i++)
+        if (interrr_lote_um(r, l, i))
+            mascara[i / 64] |= uint64_t(1) << (i % 64);
+}
+
+#if defined(__AVX__)
+constexpr int LOTE_LARGURA = 8;
+#elif defined(__SSE2__)
+constexpr int LOTE_LARGURA = 4;
+#else
+constexpr int LOTE_LARGURA = 1;
+#endif
+
+// testa o circulo c contra todos os retangulos do lote
+inline void intercr_lote(Circulo c, const LoteRetangulos& l,
+                         std::vector<uint64_t>& mascara) {
+    int n = lote_tamanho(l);
+    mascara.assign((n + 63) / 64, 0);
+    int i = 0;
+#if defined(__AVX__)
+    const __m256 cx = _mm256_set1_ps(c.centro.x);
+    const __m256 cy = _mm256_set1_ps(c.centro.y);
+    const __m256 r2 = _mm256_set1_ps(c.raio * c.raio);
+    for (; i + 8 <= n; i += 8) {
+        __m256 x0 = _mm256_loadu_ps(&l.x[i]);
+        __m256 y0 = _mm256_loadu_ps(&l.y[i]);
+        __m256 x1 = _mm256_add_ps(x0, _mm256_loadu_ps(&l.larg[i]));
+        __m256 y1 = _mm256_add_ps(y0, _mm256_loadu_ps(&l.alt[i]));
+        __m256 dx = _mm256_sub_ps(cx, _mm256_max_ps(x0, _mm256_min_ps(cx, x1)));
+        __m256 dy = _mm256_sub_ps(cy, _mm256_max_ps(y0, _mm256_min_ps(cy, y1)));
+        __m256 d2 = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+        uint64_t m = _mm256_movemask_ps(_mm256_cmp_ps(d2, r2, _CMP_LT_OQ));
+        mascara[i / 64] |= m << (i % 64);
+    }
+#elif defined(__SSE2__)
+    const __m128 cx = _mm_set1_ps(c.centro.x);
+    const __m128 cy = _mm_set1_ps(c.centro.y);
+    const __m128 r2 = _mm_set1_ps(c.raio * c.raio);
+    for (; i + 4 <= n; i += 4) {
+        __m128 x0 = _mm_loadu_ps(&l.x[i]);
+        __m128 y0 = _mm_loadu_ps(&l.y[i]);
+        __m128 x1 = _mm_add_ps(x0, _mm_loadu_ps(&l.larg[i]));
+        __m128 y1 = _mm_add_ps(y0, _mm_loadu_ps(&l.alt[i]));
+        __m128 dx = _mm_sub_ps(cx, _mm_max_ps(x0, _mm_min_ps(cx, x1)));
+        __m128 dy = _mm_sub_ps(cy, _mm_max_ps(y0, _mm_min_ps(cy, y1)));
+        __m128 d2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+        uint64_t m = _mm_movemask_ps(_mm_cmplt_ps(d2, r2));
+        mascara[i / 64] |= m << (i % 64);
+    }
+#endif
+    for (; i < n; i++)
+        if (intercr_lote_um(c, l, i))
+            mascara[i / 64] |= uint64_t(1) << (i % 64);
+}
+
+// testa o retangulo r contra todos os retangulos do lote
+inline void interrr_lote(Retangulo r, const LoteRetangulos& l,
+                         std::vector<uint64_t>& mascara) {
+    int n = lote_tamanho(l);
+    mascara.assign((n + 63) / 64, 0);
+    int i = 0;
+#if defined(__AVX__)
+    const __m256 rx0 = _mm256_set1_ps(r.pos.x);
+    const __m256 ry0 = _mm256_set1_ps(r.pos.y);
+    const __m256 rx1 = _mm256_set1_ps(r.pos.x + r.tam.larg);
+    const __m256 ry1 = _mm256_set1_ps(r.pos.y + r.tam.alt);
+    for (; i + 8 <= n; i += 8) {
+        __m256 x0 = _mm256_loadu_ps(&l.x[i]);
+        __m256 y0 = _mm256_loadu_ps(&l.y[i]);
+        __m256 x1 = _mm256_add_ps(x0, _mm256_loadu_ps(&l.larg[i]));
+        __m256 y1 = _mm256_add_ps(y0, _mm256_loadu_ps(&l.alt[i]));
+        __m256 h = _mm256_and_ps(_mm256_cmp_ps(rx0, x1, _CMP_LT_OQ),
+                                 _mm256_cmp_ps(rx1, x0, _CMP_GT_OQ));
+        __m256 v = _mm256_and_ps(_mm256_cmp_ps(ry0, y1, _CMP_LT_OQ),
+                                 _mm256_cmp_ps(ry1, y0, _CMP_GT_OQ));
+        uint64_t m = _mm256_movemask_ps(_mm256_and_ps(h, v));
+        mascara[i / 64] |= m << (i % 64);
+    }
+#elif defined(__SSE2__)
+    const __m128 rx0 = _mm_set1_ps(r.pos.x);
+    const __m128 ry0 = _mm_set1_ps(r.pos.y);
+    const __m128 rx1 = _mm_set1_ps(r.pos.x + r.tam.larg);
+    const __m128 ry1 = _mm_set1_ps(r.pos.y + r.tam.alt);
+    for (; i + 4 <= n; i += 4) {
+        __m128 x0 = _mm_loadu_ps(&l.x[i]);
+        __m128 y0 = _mm_loadu_ps(&l.y[i]);
+        __m128 x1 = _mm_add_ps(x0, _mm_loadu_ps(&l.larg[i]));
+        __m128 y1 = _mm_add_ps(y0, _mm_loadu_ps(&l.alt[i]));
+        __m128 h = _mm_and_ps(_mm_cmplt_ps(rx0, x1), _mm_cmpgt_ps(rx1, x0));
+        __m128 v = _mm_and_ps(_mm_cmplt_ps(ry0, y1), _mm_cmpgt_ps(ry1, y0));
+        uint64_t m = _mm_movemask_ps(_mm_and_ps(h, v));
+        mascara[i / 64] |= m << (i % 64);
+    }
+#endif
+    for (; i < n; i++)
+        if (interrr_lote_um(r, l, i))
+            mascara[i / 64] |= uint64_t(1) << (i % 64);
 }
 
 }; // namespace geom
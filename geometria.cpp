@@ -0,0 +1,825 @@
+// geometria.cpp
+// Testes das funcoes geometricas (geom.hpp).
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2023 João Vicente Ferreira Lima, UFSM
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#define CATCH_CONFIG_MAIN // O Catch fornece uma main()
+#define CATCH_CONFIG_NO_CPP17_UNCAUGHT_EXCEPTIONS
+#define CATCH_CONFIG_NO_POSIX_SIGNALS
+#include "catch.hpp"
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "geom.hpp"
+#include "bvh.hpp"
+#include "fixo.hpp"
+#include "formacao.hpp"
+#include "grade.hpp"
+#include "mascara.hpp"
+#include "quadtree.hpp"
+#include "varredura.hpp"
+
+using namespace geom;
+
+// Testes em tempo de compilacao: se algum falhar, este arquivo nao compila.
+
+// pontos e distancias
+static_assert(distancia2(Ponto{0, 0}, Ponto{3, 4}) == 25);
+static_assert(distancia(Ponto{0, 0}, Ponto{3, 4}) == 5);
+static_assert(distancia(Ponto{1, 1}, Ponto{1, 1}) == 0);
+static_assert(raiz_quadrada(2) > 1.41421f && raiz_quadrada(2) < 1.41422f);
+static_assert(raiz_quadrada(0.25f) == 0.5f);
+static_assert(ptemcirc(Ponto{13, 14}, Circulo{{10, 10}, 5}));  // na borda
+static_assert(!ptemcirc(Ponto{14, 14}, Circulo{{10, 10}, 5}));
+static_assert(ptemret(Ponto{5, 5}, Retangulo{{0, 0}, {10, 10}}));
+static_assert(!ptemret(Ponto{10, 5}, Retangulo{{0, 0}, {10, 10}}));  // borda fica fora
+
+// circulo e retangulo
+constexpr Retangulo RT{{20, 0}, {10, 20}};
+static_assert(maisproximo(Ponto{0, 30}, RT).x == 20 && maisproximo(Ponto{0, 30}, RT).y == 20);
+static_assert(maisproximo(Ponto{25, 10}, RT).x == 25);
+static_assert(!intercr(Circulo{{10, 10}, 5}, RT));
+static_assert(intercr(Circulo{{16, 10}, 5}, RT));
+static_assert(intercr(Circulo{{25, 10}, 1}, RT));
+static_assert(!intercr(Circulo{{15, 10}, 5}, RT));  // so encosta
+static_assert(!intercr(Circulo{{16, 24}, 5}, RT));
+static_assert(intercr(Circulo{{17, 22}, 4}, RT));
+static_assert(caixa(Circulo{{10, 10}, 5}).pos.x == 5 && caixa(Circulo{{10, 10}, 5}).tam.alt == 10);
+
+// retangulos e circulos entre si
+static_assert(interrr(Retangulo{{0, 0}, {10, 10}}, Retangulo{{5, 5}, {10, 10}}));
+static_assert(!interrr(Retangulo{{0, 0}, {10, 10}}, Retangulo{{10, 0}, {10, 10}}));
+static_assert(interrr(Retangulo{{-5, 3}, {20, 4}}, Retangulo{{3, -5}, {4, 20}}));
+static_assert(intercc(Circulo{{10, 10}, 5}, Circulo{{18, 10}, 3}));
+static_assert(!intercc(Circulo{{10, 10}, 5}, Circulo{{19, 10}, 3}));
+
+// movimento
+static_assert(tempo_impacto(Circulo{{10, 40}, 5}, Ponto{0, -60}, Retangulo{{0, 0}, {20, 20}}) == 0.25f);
+static_assert(tempo_impacto(Circulo{{30, 40}, 5}, Ponto{0, -60}, Retangulo{{0, 0}, {20, 20}}) < 0);
+static_assert(tempo_impacto(Circulo{{23, 40}, 5}, Ponto{0, -40}, Retangulo{{0, 0}, {20, 20}}) == 0.4f);
+static_assert(caixa_varrida(Circulo{{10, 40}, 5}, Ponto{-6, -60}).pos.y == -25);
+static_assert(tempo_raio(Ponto{0, 15}, Ponto{1, 0}, Retangulo{{10, 10}, {10, 10}}, 100) == 10);
+static_assert(tempo_raio(Ponto{0, 15}, Ponto{-1, 0}, Retangulo{{10, 10}, {10, 10}}, 100) < 0);
+
+// ponto fixo
+static_assert(fixo::Fixo(2) * fixo::Fixo(1.5f) == fixo::Fixo(3));
+static_assert(fixo::Fixo(1) / fixo::Fixo(3) == fixo::Fixo::bruto(21845));
+static_assert(fixo::Fixo(32767).v == 32767 * 65536);
+static_assert(fixo::Fixo(-32768).v == INT32_MIN);
+static_assert(fixo::raiz(99) == 9);
+static_assert(fixo::intercr(fixo::converte(Circulo{{16, 10}, 5}), fixo::converte(RT)));
+static_assert(!fixo::intercr(fixo::converte(Circulo{{15, 10}, 5}), fixo::converte(RT)));
+static_assert(fixo::interrr(fixo::converte(Retangulo{{-5, 3}, {20, 4}}),
+                            fixo::converte(Retangulo{{3, -5}, {4, 20}})));
+static_assert(fixo::tempo_impacto(fixo::converte(Circulo{{10, 40}, 5}), fixo::Ponto{0, -60},
+                                  fixo::converte(Retangulo{{0, 0}, {20, 20}})) ==
+              fixo::Fixo(0.25f));
+
+// vagas da formacao: raiz no meio da tela, filhos a um quarto, netos a um
+// oitavo (com a divisao inteira)
+static_assert(formacao_vaga(1).x == 290 && formacao_vaga(1).y == 0);
+static_assert(formacao_vaga(2).x == 140 && formacao_vaga(2).y == 30);
+static_assert(formacao_vaga(3).x == 440 && formacao_vaga(3).y == 30);
+static_assert(formacao_vaga(4).x == 65 && formacao_vaga(7).x == 515);
+static_assert(formacao_vaga(9).y == 90);
+static_assert(formacao_caixa(5).tam.larg == FORMACAO_INVADER);
+// a tabela e a conta direta concordam, inclusive alem da tabela
+static_assert(formacao_vaga(FORMACAO_VAGAS.size() - 1).x ==
+              formacao_calcula(FORMACAO_VAGAS.size() - 1).x);
+static_assert(formacao_vaga(FORMACAO_VAGAS.size()).y == FORMACAO_NIVEIS * FORMACAO_LINHA);
+
+// lote com n retangulos 20x20 espalhados em uma tela 600x400
+LoteRetangulos lote_aleatorio(int n, unsigned semente)
+{
+    std::mt19937 gen(semente);
+    std::uniform_real_distribution<float> px(-10, 610), py(-10, 410);
+    LoteRetangulos l;
+    for(int i = 0; i < n; i++)
+        lote_insere(l, Retangulo{{px(gen), py(gen)}, {20, 20}});
+    return l;
+}
+
+TEST_CASE("Lote circulo igual ao escalar") {
+    LoteRetangulos l = lote_aleatorio(1003, 1);
+    std::mt19937 gen(2);
+    std::uniform_real_distribution<float> px(0, 600), py(0, 400), pr(1, 40);
+    std::vector<uint64_t> m, e;
+    for(int k = 0; k < 200; k++) {
+        Circulo c{{px(gen), py(gen)}, pr(gen)};
+        intercr_lote(c, l, m);
+        intercr_lote_escalar(c, l, e);
+        REQUIRE(m == e);
+    }
+}
+
+TEST_CASE("Lote retangulo igual ao escalar") {
+    LoteRetangulos l = lote_aleatorio(1003, 3);
+    std::mt19937 gen(4);
+    std::uniform_real_distribution<float> px(0, 600), py(0, 400), pt(1, 60);
+    std::vector<uint64_t> m, e;
+    for(int k = 0; k < 200; k++) {
+        Retangulo r{{px(gen), py(gen)}, {pt(gen), pt(gen)}};
+        interrr_lote(r, l, m);
+        interrr_lote_escalar(r, l, e);
+        REQUIRE(m == e);
+    }
+}
+
+TEST_CASE("Lote casos conhecidos") {
+    LoteRetangulos l;
+    lote_insere(l, Retangulo{{0, 0}, {20, 20}});
+    lote_insere(l, Retangulo{{100, 100}, {20, 20}});
+    std::vector<uint64_t> m;
+
+    intercr_lote(Circulo{{25, 10}, 6}, l, m);
+    REQUIRE(m.size() == 1);
+    REQUIRE(m[0] == 1);
+    intercr_lote(Circulo{{25, 10}, 5}, l, m);
+    REQUIRE(m[0] == 0);
+    interrr_lote(Retangulo{{15, 15}, {90, 90}}, l, m);
+    REQUIRE(m[0] == 3);
+}
+
+TEST_CASE("Distancia ao quadrado") {
+    REQUIRE(distancia2(Ponto{0, 0}, Ponto{3, 4}) == 25);
+    REQUIRE(distancia(Ponto{0, 0}, Ponto{3, 4}) == 5);
+}
+
+TEST_CASE("Predicados com circulos") {
+    Circulo c{{10, 10}, 5};
+    REQUIRE(ptemcirc(Ponto{13, 14}, c));
+    REQUIRE(!ptemcirc(Ponto{14, 14}, c));
+
+    Retangulo r{{20, 0}, {10, 20}};
+    REQUIRE(!intercr(c, r));
+    REQUIRE(intercr(Circulo{{16, 10}, 5}, r));
+    REQUIRE(intercr(Circulo{{25, 10}, 1}, r));   // centro dentro
+    REQUIRE(!intercr(Circulo{{16, 24}, 5}, r));  // perto do canto, fora
+    REQUIRE(intercr(Circulo{{17, 22}, 4}, r));   // perto do canto, dentro
+
+    REQUIRE(intercc(c, Circulo{{18, 10}, 3}));
+    REQUIRE(!intercc(c, Circulo{{19, 10}, 3}));
+}
+
+TEST_CASE("Interseccao de retangulos") {
+    Retangulo a{{0, 0}, {10, 10}};
+    REQUIRE(interrr(a, Retangulo{{5, 5}, {10, 10}}));
+    REQUIRE(!interrr(a, Retangulo{{10, 0}, {10, 10}}));  // so encosta
+    // em cruz: nenhum canto de um dentro do outro
+    REQUIRE(interrr(Retangulo{{-5, 3}, {20, 4}}, Retangulo{{3, -5}, {4, 20}}));
+}
+
+TEST_CASE("Grade devolve os mesmos pares que a forca bruta") {
+    LoteRetangulos l = lote_aleatorio(2000, 5);
+    Grade g;
+    grade_inicia(g, 32, 1024);
+    grade_constroi(g, l);
+
+    std::mt19937 gen(6);
+    std::uniform_real_distribution<float> px(-20, 620), py(-20, 420), pr(1, 50);
+    std::vector<int> candidatos;
+    for(int k = 0; k < 300; k++) {
+        Circulo c{{px(gen), py(gen)}, pr(gen)};
+        grade_consulta(g, caixa(c), candidatos);
+        std::vector<bool> candidato(lote_tamanho(l), false);
+        for(int i : candidatos) {
+            REQUIRE(!candidato[i]);  // sem repeticao
+            candidato[i] = true;
+        }
+        for(int i = 0; i < lote_tamanho(l); i++)
+            if(intercr_lote_um(c, l, i))
+                REQUIRE(candidato[i]);
+    }
+}
+
+// confere os pares da varredura (e os eventos do quadro) contra a forca bruta
+void confere_varredura(const Varredura& s, std::set<std::pair<int, int>>& antes)
+{
+    std::set<std::pair<int, int>> agora;
+    for(size_t i = 0; i < s.caixas.size(); i++)
+        for(size_t j = i + 1; j < s.caixas.size(); j++)
+            if(s.ativo[i] && s.ativo[j] && interrr(s.caixas[i], s.caixas[j]))
+                agora.insert({int(i), int(j)});
+    REQUIRE(s.pares.size() == agora.size());
+    for(auto [a, b] : agora)
+        REQUIRE(s.pares.count(varredura_chave(a, b)) == 1);
+
+    std::set<std::pair<int, int>> esperado = antes;
+    for(const Varredura::Evento& e : s.eventos) {
+        std::pair<int, int> p{std::min(e.a, e.b), std::max(e.a, e.b)};
+        if(e.novo)
+            REQUIRE(esperado.insert(p).second);
+        else
+            REQUIRE(esperado.erase(p) == 1);
+    }
+    REQUIRE(esperado == agora);
+    antes = agora;
+}
+
+TEST_CASE("Varredura devolve os mesmos pares que a forca bruta") {
+    std::mt19937 gen(9);
+    std::uniform_real_distribution<float> px(0, 600), py(0, 400), passo(-3, 3);
+    Varredura s;
+    std::vector<int> ids;
+    for(int i = 0; i < 300; i++)
+        ids.push_back(varredura_insere(s, Retangulo{{px(gen), py(gen)}, {20, 20}}));
+    std::set<std::pair<int, int>> antes;
+    varredura_atualiza(s);
+    confere_varredura(s, antes);
+
+    for(int quadro = 0; quadro < 50; quadro++) {
+        varredura_limpa_eventos(s);
+        // a formacao anda junta, com algum tremor individual
+        float dx = passo(gen), dy = passo(gen);
+        for(int id : ids) {
+            Retangulo r = s.caixas[id];
+            r.pos.x += dx + passo(gen);
+            r.pos.y += dy + passo(gen);
+            varredura_move(s, id, r);
+        }
+        // alguns morrem e outros nascem
+        for(int k = 0; k < 3; k++) {
+            size_t i = gen() % ids.size();
+            varredura_remove(s, ids[i]);
+            ids[i] = varredura_insere(s, Retangulo{{px(gen), py(gen)}, {20, 20}});
+        }
+        varredura_atualiza(s);
+        confere_varredura(s, antes);
+    }
+}
+
+TEST_CASE("Remover da varredura so desfaz os pares da caixa") {
+    Varredura s;
+    // b toca a e c; a e c nao se tocam; d esta longe de todos
+    int a = varredura_insere(s, Retangulo{{0, 0}, {20, 20}});
+    int b = varredura_insere(s, Retangulo{{10, 10}, {20, 20}});
+    int c = varredura_insere(s, Retangulo{{25, 25}, {20, 20}});
+    int d = varredura_insere(s, Retangulo{{100, 100}, {20, 20}});
+    varredura_atualiza(s);
+    REQUIRE(s.pares.size() == 2);
+    varredura_limpa_eventos(s);
+
+    varredura_remove(s, b);
+    REQUIRE(s.eventos.size() == 2);
+    for(const Varredura::Evento& e : s.eventos) {
+        REQUIRE(!e.novo);
+        REQUIRE((e.a == b || e.b == b));
+    }
+    REQUIRE(s.pares.empty());
+    REQUIRE(s.eixos.count(varredura_chave(a, b)) == 0);
+    REQUIRE(s.eixos.count(varredura_chave(b, c)) == 0);
+    REQUIRE(s.eixo[0].size() == 6);
+    REQUIRE(s.eixo[1].size() == 6);
+
+    // o resto continua funcionando
+    varredura_limpa_eventos(s);
+    varredura_move(s, d, Retangulo{{30, 30}, {20, 20}});
+    varredura_atualiza(s);
+    REQUIRE(s.eventos.size() == 1);
+    REQUIRE(s.pares.count(varredura_chave(c, d)) == 1);
+}
+
+TEST_CASE("Varredura com coordenadas inteiras") {
+    // caixas que so encostam nao se tocam, em qualquer ordem de insercao
+    for(int ordem = 0; ordem < 2; ordem++) {
+        Varredura s;
+        Retangulo a{{0, 0}, {20, 20}}, b{{20, 0}, {20, 20}};
+        varredura_insere(s, ordem ? b : a);
+        varredura_insere(s, ordem ? a : b);
+        varredura_atualiza(s);
+        REQUIRE(s.pares.empty());
+        REQUIRE(!interrr(a, b));
+    }
+
+    // grade de caixas encostadas andando de pixel em pixel: muitos
+    // extremos com o mesmo valor
+    std::mt19937 gen(34);
+    std::uniform_int_distribution<int> passo(-1, 1);
+    Varredura s;
+    std::vector<int> ids;
+    for(int y = 0; y < 6; y++)
+        for(int x = 0; x < 8; x++)
+            ids.push_back(varredura_insere(s, Retangulo{{float(20 * x), float(20 * y)}, {20, 20}}));
+    std::set<std::pair<int, int>> antes;
+    varredura_atualiza(s);
+    confere_varredura(s, antes);
+    REQUIRE(s.pares.empty());
+
+    for(int quadro = 0; quadro < 50; quadro++) {
+        varredura_limpa_eventos(s);
+        for(int id : ids) {
+            Retangulo r = s.caixas[id];
+            r.pos.x += passo(gen);
+            r.pos.y += passo(gen);
+            varredura_move(s, id, r);
+        }
+        varredura_atualiza(s);
+        confere_varredura(s, antes);
+    }
+}
+
+TEST_CASE("Tempo de impacto de circulo com retangulo") {
+    Retangulo r{{0, 0}, {20, 20}};
+    // de baixo para cima, atravessando o retangulo em um passo so
+    REQUIRE(tempo_impacto(Circulo{{10, 40}, 5}, Ponto{0, -60}, r) == Approx(15.0f / 60));
+    REQUIRE(!intercr(Circulo{{10, -20}, 5}, r));  // so o fim do passo erraria
+    // ja comeca tocando
+    REQUIRE(tempo_impacto(Circulo{{10, 10}, 5}, Ponto{0, -60}, r) == 0);
+    // passa ao lado
+    REQUIRE(tempo_impacto(Circulo{{30, 40}, 5}, Ponto{0, -60}, r) < 0);
+    // nao chega
+    REQUIRE(tempo_impacto(Circulo{{10, 60}, 5}, Ponto{0, -20}, r) < 0);
+    // parado
+    REQUIRE(tempo_impacto(Circulo{{10, 60}, 5}, Ponto{0, 0}, r) < 0);
+    // pelo canto (20, 20): o centro passa a 3 do canto em x
+    float t = tempo_impacto(Circulo{{23, 40}, 5}, Ponto{0, -40}, r);
+    REQUIRE(t == Approx((20 - 4.0f) / 40));
+    // na diagonal contra o canto
+    REQUIRE(tempo_impacto(Circulo{{40, 40}, 5}, Ponto{-20, -20}, r) ==
+            Approx((20 - 5 / std::sqrt(2.0f)) / 20));
+    // cruza a regiao do canto sem tocar o circulo do canto
+    REQUIRE(tempo_impacto(Circulo{{29.5f, 20}, 5}, Ponto{-10, 10}, r) < 0);
+
+    REQUIRE(interrr(caixa_varrida(Circulo{{10, 40}, 5}, Ponto{0, -60}), r));
+    Retangulo v = caixa_varrida(Circulo{{10, 40}, 5}, Ponto{-6, -60});
+    REQUIRE(v.pos.x == -1);
+    REQUIRE(v.pos.y == -25);
+    REQUIRE(v.tam.larg == 16);
+    REQUIRE(v.tam.alt == 70);
+}
+
+TEST_CASE("Tempo de impacto igual a amostragem fina") {
+    std::mt19937 gen(10);
+    std::uniform_real_distribution<float> pp(-60, 80), pd(-80, 80), pr(1, 15);
+    Retangulo r{{0, 0}, {20, 20}};
+    const int passos = 4000;
+    for(int k = 0; k < 2000; k++) {
+        Circulo c{{pp(gen), pp(gen)}, pr(gen)};
+        Ponto d{pd(gen), pd(gen)};
+        float t = tempo_impacto(c, d, r);
+
+        int i = 0;
+        for(; i <= passos; i++) {
+            float s = float(i) / passos;
+            if(intercr(Circulo{{c.centro.x + s * d.x, c.centro.y + s * d.y}, c.raio}, r))
+                break;
+        }
+        if(i <= passos) {
+            REQUIRE(t >= 0);
+            REQUIRE(t <= float(i) / passos + 1e-4f);
+            REQUIRE(t >= float(i - 1) / passos - 1e-4f);
+        } else if(t >= 0) {
+            // so encosta: a amostragem nao ve o contato
+            Circulo maior{{c.centro.x + t * d.x, c.centro.y + t * d.y}, c.raio * 1.01f};
+            REQUIRE(intercr(maior, r));
+        }
+    }
+}
+
+// retangulos de tamanhos variados espalhados em uma tela 600x400
+std::vector<Retangulo> retangulos_aleatorios(int n, unsigned semente)
+{
+    std::mt19937 gen(semente);
+    std::uniform_real_distribution<float> px(-10, 610), py(-10, 410), pt(1, 30);
+    std::vector<Retangulo> rs;
+    for(int i = 0; i < n; i++)
+        rs.push_back(Retangulo{{px(gen), py(gen)}, {pt(gen), pt(gen)}});
+    return rs;
+}
+
+// confere as tres consultas da Bvh contra a forca bruta
+void confere_bvh(const Bvh& b, const std::vector<Retangulo>& rs, unsigned semente)
+{
+    std::mt19937 gen(semente);
+    std::uniform_real_distribution<float> px(-20, 620), py(-20, 420), pr(1, 60), pd(-1, 1);
+    std::vector<int> saida;
+    for(int k = 0; k < 100; k++) {
+        Circulo c{{px(gen), py(gen)}, pr(gen)};
+        bvh_circulo(b, c, saida);
+        std::set<int> achados(saida.begin(), saida.end());
+        REQUIRE(achados.size() == saida.size());
+        std::set<int> esperados;
+        for(size_t i = 0; i < rs.size(); i++)
+            if(intercr(c, rs[i]))
+                esperados.insert(i);
+        REQUIRE(achados == esperados);
+
+        Retangulo r{{px(gen), py(gen)}, {pr(gen), pr(gen)}};
+        bvh_retangulo(b, r, saida);
+        achados = std::set<int>(saida.begin(), saida.end());
+        esperados.clear();
+        for(size_t i = 0; i < rs.size(); i++)
+            if(interrr(r, rs[i]))
+                esperados.insert(i);
+        REQUIRE(achados == esperados);
+
+        Ponto o{px(gen), py(gen)}, d{pd(gen), pd(gen)};
+        float t;
+        int i = bvh_raio(b, o, d, 300, t);
+        int ei = -1;
+        float et = 300;
+        for(size_t j = 0; j < rs.size(); j++) {
+            float tj = tempo_raio(o, d, rs[j], 300);
+            if(tj >= 0 && (ei < 0 || tj < et)) {
+                ei = j;
+                et = tj;
+            }
+        }
+        REQUIRE(i == ei);
+        if(i >= 0)
+            REQUIRE(t == et);
+    }
+}
+
+TEST_CASE("Raio contra retangulo") {
+    Retangulo r{{10, 10}, {10, 10}};
+    REQUIRE(tempo_raio(Ponto{0, 15}, Ponto{1, 0}, r, 100) == 10);
+    REQUIRE(tempo_raio(Ponto{0, 15}, Ponto{1, 0}, r, 5) < 0);    // curto demais
+    REQUIRE(tempo_raio(Ponto{0, 15}, Ponto{-1, 0}, r, 100) < 0); // para tras
+    REQUIRE(tempo_raio(Ponto{15, 15}, Ponto{0, 1}, r, 100) == 0); // dentro
+    REQUIRE(tempo_raio(Ponto{0, 0}, Ponto{1, 1}, r, 100) == 10);
+    REQUIRE(tempo_raio(Ponto{0, 25}, Ponto{1, 0}, r, 100) < 0);
+}
+
+TEST_CASE("Bvh devolve o mesmo que a forca bruta") {
+    std::vector<Retangulo> rs = retangulos_aleatorios(3000, 11);
+    Bvh b;
+    bvh_constroi(b, rs);
+    REQUIRE(b.itens.size() == rs.size());
+    confere_bvh(b, rs, 12);
+
+    // a formacao anda junta: ajusta sem reconstruir
+    for(int passo = 0; passo < 5; passo++) {
+        for(Retangulo& r : rs) {
+            r.pos.x += 7;
+            r.pos.y -= 3;
+        }
+        bvh_ajusta(b, rs);
+        confere_bvh(b, rs, 13 + passo);
+    }
+
+    Bvh vazia;
+    bvh_constroi(vazia, {});
+    std::vector<int> saida{1};
+    bvh_circulo(vazia, Circulo{{0, 0}, 10}, saida);
+    REQUIRE(saida.empty());
+    float t;
+    REQUIRE(bvh_raio(vazia, Ponto{0, 0}, Ponto{1, 0}, 10, t) == -1);
+}
+
+// confere as consultas da quadtree contra a forca bruta sobre os vivos
+void confere_quadtree(const Quadtree& q, const std::vector<int>& ids, unsigned semente)
+{
+    std::mt19937 gen(semente);
+    std::uniform_real_distribution<float> px(-50, 650), py(-50, 450), pt(0, 80);
+    std::vector<int> saida;
+    for(int k = 0; k < 50; k++) {
+        Retangulo area{{px(gen), py(gen)}, {pt(gen), pt(gen)}};
+        quadtree_consulta(q, area, saida);
+        std::set<int> achados(saida.begin(), saida.end());
+        REQUIRE(achados.size() == saida.size());
+        std::set<int> esperados;
+        for(int id : ids)
+            if(interrr(area, q.itens[id].r))
+                esperados.insert(id);
+        REQUIRE(achados == esperados);
+
+        Ponto p{px(gen), py(gen)};
+        quadtree_ponto(q, p, saida);
+        achados = std::set<int>(saida.begin(), saida.end());
+        esperados.clear();
+        for(int id : ids)
+            if(ptemret(p, q.itens[id].r))
+                esperados.insert(id);
+        REQUIRE(achados == esperados);
+    }
+}
+
+TEST_CASE("Quadtree devolve o mesmo que a forca bruta") {
+    Quadtree q;
+    quadtree_inicia(q, Retangulo{{0, 0}, {600, 400}});
+    std::mt19937 gen(14);
+    // a maioria na faixa da formacao, alguns grandes e alguns fora da tela
+    std::uniform_real_distribution<float> px(-30, 630), py(0, 120), pt(1, 30), pg(100, 700);
+    std::vector<int> ids;
+    for(int i = 0; i < 1500; i++) {
+        Retangulo r{{px(gen), py(gen)}, {pt(gen), pt(gen)}};
+        if(i % 100 == 0)
+            r.tam = Tamanho{pg(gen), pg(gen) / 2};
+        ids.push_back(quadtree_insere(q, r));
+    }
+    confere_quadtree(q, ids, 15);
+
+    std::uniform_real_distribution<float> passo(-4, 4);
+    for(int quadro = 0; quadro < 30; quadro++) {
+        float dx = passo(gen), dy = passo(gen);
+        for(int id : ids) {
+            Retangulo r = q.itens[id].r;
+            r.pos.x += dx;
+            r.pos.y += dy + quadro % 3;
+            quadtree_move(q, id, r);
+        }
+        for(int k = 0; k < 20; k++) {
+            size_t i = gen() % ids.size();
+            quadtree_remove(q, ids[i]);
+            ids[i] = quadtree_insere(q, Retangulo{{px(gen), py(gen)}, {pt(gen), pt(gen)}});
+        }
+        confere_quadtree(q, ids, 16 + quadro);
+    }
+    REQUIRE(q.nos[0].total == (int)ids.size());
+
+    // removendo tudo sobra so a raiz, e os nos voltam para o reservatorio
+    for(int id : ids)
+        quadtree_remove(q, id);
+    REQUIRE(q.nos[0].total == 0);
+    for(int f : q.nos[0].filhos)
+        REQUIRE(f == -1);
+    REQUIRE(q.nos_livres.size() == q.nos.size() - 1);
+    size_t nos = q.nos.size();
+    for(int i = 0; i < 1500; i++)
+        quadtree_insere(q, Retangulo{{px(gen), py(gen)}, {pt(gen), pt(gen)}});
+    REQUIRE(q.nos.size() <= nos + nos / 2);
+}
+
+TEST_CASE("Aritmetica em ponto fixo") {
+    using fixo::Fixo;
+    REQUIRE(Fixo(3).v == 3 * 65536);
+    REQUIRE(Fixo(1.5f).v == 98304);
+    REQUIRE(Fixo(-1.5f).v == -98304);
+    REQUIRE(Fixo(2) * Fixo(1.5f) == Fixo(3));
+    REQUIRE(Fixo(3) / Fixo(2) == Fixo(1.5f));
+    REQUIRE(Fixo(1) / Fixo(3) == Fixo::bruto(21845));   // trunca
+    REQUIRE(Fixo(-1) / Fixo(3) == Fixo::bruto(-21845));
+    REQUIRE(fixo::real(Fixo(-2.25f)) == -2.25f);
+    REQUIRE(fixo::raiz(0) == 0);
+    REQUIRE(fixo::raiz(99) == 9);
+    REQUIRE(fixo::raiz(uint64_t(65536) * 65536 * 4) == 131072);
+}
+
+TEST_CASE("Predicados em ponto fixo iguais aos em float") {
+    // com coordenadas inteiras os dois sao exatos e tem que concordar
+    std::mt19937 gen(17);
+    std::uniform_int_distribution<int> pp(-50, 650), pt(0, 40), pr(1, 30);
+    for(int k = 0; k < 20000; k++) {
+        Retangulo a{{float(pp(gen)), float(pp(gen))}, {float(pt(gen)), float(pt(gen))}};
+        Retangulo b{{float(pp(gen)), float(pp(gen))}, {float(pt(gen)), float(pt(gen))}};
+        Circulo c{{float(pp(gen)), float(pp(gen))}, float(pr(gen))};
+        Ponto p{float(pp(gen)), float(pp(gen))};
+        REQUIRE(fixo::interrr(fixo::converte(a), fixo::converte(b)) == interrr(a, b));
+        REQUIRE(fixo::intercr(fixo::converte(c), fixo::converte(a)) == intercr(c, a));
+        REQUIRE(fixo::ptemret(fixo::converte(p), fixo::converte(a)) == ptemret(p, a));
+        REQUIRE(fixo::ptemcirc(fixo::converte(p), fixo::converte(c)) == ptemcirc(p, c));
+    }
+}
+
+TEST_CASE("Lote em ponto fixo igual ao escalar") {
+    LoteRetangulos lf = lote_aleatorio(1003, 18);
+    fixo::LoteRetangulos l;
+    for(int i = 0; i < lote_tamanho(lf); i++)
+        fixo::lote_insere(l, lote_retangulo(lf, i));
+    std::mt19937 gen(19);
+    std::uniform_real_distribution<float> px(0, 600), py(0, 400), pr(1, 40);
+    std::vector<uint64_t> m, e;
+    for(int k = 0; k < 200; k++) {
+        fixo::Circulo c = fixo::converte(Circulo{{px(gen), py(gen)}, pr(gen)});
+        fixo::intercr_lote(c, l, m);
+        fixo::intercr_lote_escalar(c, l, e);
+        REQUIRE(m == e);
+        fixo::Retangulo r = fixo::converte(Retangulo{{px(gen), py(gen)}, {pr(gen), pr(gen)}});
+        fixo::interrr_lote(r, l, m);
+        fixo::interrr_lote_escalar(r, l, e);
+        REQUIRE(m == e);
+    }
+}
+
+TEST_CASE("Tempo de impacto em ponto fixo") {
+    using fixo::Fixo;
+    fixo::Retangulo r = fixo::converte(Retangulo{{0, 0}, {20, 20}});
+    REQUIRE(fixo::tempo_impacto(fixo::converte(Circulo{{10, 40}, 5}), fixo::Ponto{0, -60}, r) ==
+            Fixo(15) / Fixo(60));
+    REQUIRE(fixo::tempo_impacto(fixo::converte(Circulo{{30, 40}, 5}), fixo::Ponto{0, -60}, r) < 0);
+
+    // perto do resultado em float
+    std::mt19937 gen(20);
+    std::uniform_real_distribution<float> pp(-40, 60), pd(-20, 20), pr(1, 10);
+    Retangulo rf{{0, 0}, {20, 20}};
+    int acertos = 0;
+    for(int k = 0; k < 5000; k++) {
+        Circulo c{{pp(gen), pp(gen)}, pr(gen)};
+        Ponto d{pd(gen), pd(gen)};
+        float t = tempo_impacto(c, d, rf);
+        Fixo tf = fixo::tempo_impacto(fixo::converte(c), fixo::converte(d), r);
+        if(t >= 0 && tf >= 0) {
+            REQUIRE(fixo::real(tf) == Approx(t).margin(2e-3));
+            acertos++;
+        } else if(t >= 0 || tf >= 0) {
+            // so encosta: a diferenca de arredondamento decide
+            Circulo maior{{c.centro.x + std::max(t, fixo::real(tf)) * d.x,
+                           c.centro.y + std::max(t, fixo::real(tf)) * d.y}, c.raio * 1.01f};
+            REQUIRE(intercr(maior, rf));
+        }
+    }
+    REQUIRE(acertos > 500);
+}
+
+// move_arvore antigo: divide [x0, x1] ao meio a cada nivel
+void vagas_recursivo(unsigned vaga, int x0, int x1, int y0, std::vector<Ponto>& p)
+{
+    if(vaga >= p.size())
+        return;
+    p[vaga] = Ponto{float(x0 + (x1 - x0) / 2 - 10), float(y0)};
+    vagas_recursivo(2 * vaga, x0, x0 + (x1 - x0) / 2, y0 + 30, p);
+    vagas_recursivo(2 * vaga + 1, x0 + (x1 - x0) / 2, x1, y0 + 30, p);
+}
+
+TEST_CASE("Tabela de vagas igual ao calculo recursivo") {
+    std::vector<Ponto> p(4 * FORMACAO_VAGAS.size());
+    vagas_recursivo(1, 0, 600, 0, p);
+    for(unsigned v = 1; v < p.size(); v++) {
+        REQUIRE(formacao_vaga(v).x == p[v].x);
+        REQUIRE(formacao_vaga(v).y == p[v].y);
+    }
+}
+
+TEST_CASE("Raiz em tempo de compilacao perto da de execucao") {
+    std::mt19937 gen(21);
+    std::uniform_real_distribution<float> px(0, 1000);
+    constexpr float r2 = raiz_quadrada(2);
+    volatile float dois = 2;
+    REQUIRE(r2 == Approx(std::sqrt(float(dois))).epsilon(1e-7));
+    for(int k = 0; k < 1000; k++) {
+        Ponto a{px(gen), px(gen)}, b{px(gen), px(gen)};
+        REQUIRE(distancia(a, b) == std::sqrt(distancia2(a, b)));
+    }
+}
+
+Mascara mascara_aleatoria(std::mt19937& gen, int larg, int alt, float densidade)
+{
+    std::bernoulli_distribution liga(densidade);
+    Mascara m;
+    mascara_inicia(m, larg, alt);
+    for(int y = 0; y < alt; y++)
+        for(int x = 0; x < larg; x++)
+            if(liga(gen))
+                mascara_liga(m, x, y);
+    return m;
+}
+
+// pixel a pixel
+bool mascara_toca_pixels(const Mascara& a, int ax, int ay, const Mascara& b, int bx, int by)
+{
+    for(int y = 0; y < a.alt; y++)
+        for(int x = 0; x < a.larg; x++) {
+            int u = ax + x - bx, v = ay + y - by;
+            if(mascara_bit(a, x, y) && u >= 0 && u < b.larg && v >= 0 && v < b.alt &&
+               mascara_bit(b, u, v))
+                return true;
+        }
+    return false;
+}
+
+TEST_CASE("Mascara a partir de desenho") {
+    Mascara m;
+    mascara_desenho(m, {"..#..",
+                        ".###.",
+                        "## ##"});
+    REQUIRE(m.larg == 5);
+    REQUIRE(m.alt == 3);
+    REQUIRE(mascara_conta(m) == 8);
+    REQUIRE(mascara_bit(m, 2, 0));
+    REQUIRE(!mascara_bit(m, 2, 2));
+
+    uint32_t px[] = {0xff000000, 0x00ffffff, 0x80000000, 0x7f000000};
+    mascara_pixels(m, px, 2, 2);
+    REQUIRE(mascara_bit(m, 0, 0));
+    REQUIRE(!mascara_bit(m, 1, 0));
+    REQUIRE(mascara_bit(m, 0, 1));
+    REQUIRE(!mascara_bit(m, 1, 1));
+
+    mascara_circulo(m, 3);
+    REQUIRE(m.larg == 7);
+    REQUIRE(mascara_bit(m, 3, 3));
+    REQUIRE(!mascara_bit(m, 0, 0));
+}
+
+TEST_CASE("Mascara so colide onde ha pixels") {
+    Mascara a, b;
+    // dois L que se encaixam sem se tocar
+    mascara_desenho(a, {"#...",
+                        "#...",
+                        "####"});
+    mascara_desenho(b, {"####",
+                        "...#",
+                        "...#"});
+    REQUIRE(interrr(mascara_caixa(a, 0, 0), mascara_caixa(b, 1, -1)));
+    REQUIRE(!mascara_toca(a, 0, 0, b, 1, -1));
+    REQUIRE(mascara_toca(a, 0, 0, b, 0, 0));
+    REQUIRE(!mascara_toca(a, 0, 0, b, 10, 0));
+}
+
+TEST_CASE("Mascara igual ao teste pixel a pixel") {
+    std::mt19937 gen(22);
+    std::uniform_int_distribution<int> tam(1, 150), pos(-160, 160);
+    for(int k = 0; k < 2000; k++) {
+        // metade com figuras de ate 64 pixels (caminho vetorizado)
+        int la = (k % 2) ? tam(gen) : 1 + tam(gen) % 64;
+        int lb = (k % 2) ? tam(gen) : 1 + tam(gen) % 64;
+        Mascara a = mascara_aleatoria(gen, la, tam(gen), 0.02f);
+        Mascara b = mascara_aleatoria(gen, lb, tam(gen), 0.02f);
+        int ax = pos(gen), ay = pos(gen), bx = pos(gen) / 4, by = pos(gen) / 4;
+        REQUIRE(mascara_toca(a, ax, ay, b, bx, by) == mascara_toca_pixels(a, ax, ay, b, bx, by));
+        REQUIRE(mascara_toca(b, bx, by, a, ax, ay) == mascara_toca_pixels(a, ax, ay, b, bx, by));
+    }
+}
+
+TEST_CASE("Mascara varrida so toca onde ha pixels") {
+    // arco aberto para baixo: a caixa comeca na linha 3, os pixels do meio
+    // so na linha 0
+    Mascara a, b;
+    mascara_desenho(a, {"#########",
+                        "#.......#",
+                        "#.......#",
+                        "#.......#"});
+    mascara_cheia(b, 1, 1);
+    // subindo pelo meio so toca no topo; pela lateral, logo na caixa
+    REQUIRE(mascara_varrida(a, 0, 0, b, 4, 10, 0, -10) == Approx(1.0));
+    REQUIRE(mascara_varrida(a, 0, 0, b, 0, 10, 0, -10) == Approx(0.7));
+    // a caixa e tocada, mas nenhum pixel
+    REQUIRE(interrr(mascara_caixa(a, 0, 0), mascara_caixa(b, 4, 1)));
+    REQUIRE(mascara_varrida(a, 0, 0, b, 4, 10, 0, -9) < 0);
+    REQUIRE(mascara_varrida(a, 0, 0, b, 20, 10, 0, -10) < 0);
+    // parado e ja tocando
+    REQUIRE(mascara_varrida(a, 0, 0, b, 8, 2, 0, 0) == 0);
+
+    mascara_cheia(b, 3, 2);
+    REQUIRE(mascara_conta(b) == 6);
+    // um tiro rapido nao atravessa a linha fina do topo
+    REQUIRE(mascara_varrida(a, 0, 0, b, 3, -40, 0, 80) == Approx(39.0 / 80));
+}
+
+TEST_CASE("Apagar da mascara so mexe nos pixels cobertos") {
+    std::mt19937 gen(23);
+    std::uniform_int_distribution<int> pos(-20, 150);
+    Mascara escudo = mascara_aleatoria(gen, 140, 40, 0.7f), cratera;
+    mascara_circulo(cratera, 6);
+    for(int k = 0; k < 200; k++) {
+        Mascara antes = escudo;
+        int cx = pos(gen), cy = pos(gen) / 3;
+        int n = mascara_apaga(escudo, 0, 0, cratera, cx, cy);
+        int apagados = 0;
+        for(int y = 0; y < escudo.alt; y++)
+            for(int x = 0; x < escudo.larg; x++) {
+                int u = x - cx, v = y - cy;
+                bool coberto = u >= 0 && u < cratera.larg && v >= 0 && v < cratera.alt &&
+                               mascara_bit(cratera, u, v);
+                REQUIRE(mascara_bit(escudo, x, y) == (mascara_bit(antes, x, y) && !coberto));
+                apagados += mascara_bit(antes, x, y) && coberto;
+            }
+        REQUIRE(n == apagados);
+        REQUIRE(!mascara_toca(escudo, 0, 0, cratera, cx, cy));
+    }
+}
+
+TEST_CASE("Trechos da mascara cobrem os pixels ligados") {
+    std::mt19937 gen(24);
+    for(float densidade : {0.1f, 0.5f, 0.95f, 1.0f}) {
+        Mascara m = mascara_aleatoria(gen, 150, 10, densidade), r;
+        mascara_inicia(r, m.larg, m.alt);
+        int anterior_y = -1, anterior_x1 = -1;
+        mascara_trechos(m, [&](int x0, int x1, int y) {
+            REQUIRE(x0 < x1);
+            // trechos nao se encostam: senao seriam um so
+            if(y == anterior_y)
+                REQUIRE(x0 > anterior_x1);
+            anterior_y = y;
+            anterior_x1 = x1;
+            for(int x = x0; x < x1; x++)
+                mascara_liga(r, x, y);
+        });
+        REQUIRE(r.bits == m.bits);
+    }
+}
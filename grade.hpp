@@ -0,0 +1,137 @@
+// grade.hpp
+// Grade uniforme com tabela hash (spatial hash) para achar rapidamente os
+// retangulos perto de uma regiao, antes dos testes exatos de geom.hpp.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2023 João Vicente Ferreira Lima, UFSM
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "geom.hpp"
+
+namespace geom {
+
+// O plano e dividido em celulas quadradas de lado 'lado'; cada celula cai
+// em um dos 'nbaldes' baldes da tabela. Um retangulo e guardado em todos os
+// baldes das celulas que ele toca. Os baldes ficam em um vetor so (indices
+// de 'inicio[b]' ate 'inicio[b+1]'), entao reconstruir a grade a cada
+// quadro nao aloca memoria depois do primeiro quadro.
+struct Grade {
+    float lado;                  // lado de uma celula
+    unsigned nbaldes;            // potencia de 2
+    std::vector<int> inicio;     // nbaldes+1 posicoes em 'itens'
+    std::vector<int> itens;      // indices dos retangulos, por balde
+    std::vector<unsigned> marca; // evita repetir um indice numa consulta
+    unsigned consulta;
+    std::vector<unsigned> tmp;   // balde de cada entrada durante a montagem
+    std::vector<int> cursor;     // proxima posicao livre de cada balde
+};
+
+// celula que contem a coordenada v (arredonda para baixo, sem libm)
+inline int grade_celula(const Grade& g, float v) {
+    float q = v / g.lado;
+    int i = (int)q;
+    return (q < i) ? i - 1 : i;
+}
+
+inline unsigned grade_balde(const Grade& g, int cx, int cy) {
+    return ((unsigned)cx * 73856093u ^ (unsigned)cy * 19349663u) & (g.nbaldes - 1);
+}
+
+// lado deve ser proximo do tamanho tipico dos objetos; nbaldes e
+// arredondado para uma potencia de 2
+inline void grade_inicia(Grade& g, float lado, unsigned nbaldes) {
+    g.lado = lado;
+    g.nbaldes = 1;
+    while (g.nbaldes < nbaldes)
+        g.nbaldes <<= 1;
+    g.inicio.assign(g.nbaldes + 1, 0);
+    g.itens.clear();
+    g.marca.clear();
+    g.consulta = 0;
+}
+
+// aplica f(balde) a cada celula tocada por r
+template <typename F>
+void grade_celulas(const Grade& g, Retangulo r, F&& f) {
+    int x0 = grade_celula(g, r.pos.x), x1 = grade_celula(g, r.pos.x + r.tam.larg);
+    int y0 = grade_celula(g, r.pos.y), y1 = grade_celula(g, r.pos.y + r.tam.alt);
+    for (int cy = y0; cy <= y1; cy++)
+        for (int cx = x0; cx <= x1; cx++)
+            f(grade_balde(g, cx, cy));
+}
+
+// monta a grade com todos os retangulos do lote (indice i = retangulo i)
+inline void grade_constroi(Grade& g, const LoteRetangulos& l) {
+    int n = lote_tamanho(l);
+
+    // conta as entradas de cada balde
+    g.inicio.assign(g.nbaldes + 1, 0);
+    g.tmp.clear();
+    for (int i = 0; i < n; i++) {
+        Retangulo r{{l.x[i], l.y[i]}, {l.larg[i], l.alt[i]}};
+        grade_celulas(g, r, [&g](unsigned b) {
+            g.inicio[b + 1]++;
+            g.tmp.push_back(b);
+        });
+    }
+    for (unsigned b = 0; b < g.nbaldes; b++)
+        g.inicio[b + 1] += g.inicio[b];
+
+    // distribui os indices (mesma ordem das celulas de cima)
+    g.itens.resize(g.tmp.size());
+    g.cursor.assign(g.inicio.begin(), g.inicio.end() - 1);
+    size_t e = 0;
+    for (int i = 0; i < n; i++) {
+        Retangulo r{{l.x[i], l.y[i]}, {l.larg[i], l.alt[i]}};
+        grade_celulas(g, r, [&](unsigned) { g.itens[g.cursor[g.tmp[e++]]++] = i; });
+    }
+
+    if (g.marca.size() < (size_t)n)
+        g.marca.resize(n, 0);
+}
+
+// coloca em 'saida' os indices dos retangulos que podem tocar 'area' (os
+// que estao nas mesmas celulas; ainda e preciso fazer o teste exato)
+inline void grade_consulta(Grade& g, Retangulo area, std::vector<int>& saida) {
+    saida.clear();
+    if (++g.consulta == 0) {
+        // o contador deu a volta; zera as marcas antigas
+        std::fill(g.marca.begin(), g.marca.end(), 0);
+        g.consulta = 1;
+    }
+    grade_celulas(g, area, [&](unsigned b) {
+        for (int k = g.inicio[b]; k < g.inicio[b + 1]; k++) {
+            int i = g.itens[k];
+            if (g.marca[i] != g.consulta) {
+                g.marca[i] = g.consulta;
+                saida.push_back(i);
+            }
+        }
+    });
+}
+
+}; // namespace geom
@@ -30,11 +30,19 @@
 #include <iostream>
 #include <functional>
 #include <cstdlib>
+#include <cstring>
 #include <allegro5/allegro5.h>
 #include "abb.hpp"
+#include "arvb.hpp"
+#include "paralelo.hpp"
 
 #include "tela.hpp"
 #include "geom.hpp"
+#include "fixo.hpp"
+#include "formacao.hpp"
+#include "mascara.hpp"
+#include "quadtree.hpp"
+#include "tempo.hpp"
 
 using namespace tela;
 using namespace geom;
@@ -62,6 +70,12 @@ struct tiro_t {
   Circulo  c; /* figura */
 };
 
+/* escudo que os tiros vão destruindo */
+struct Escudo {
+  Mascara m;  // pixels que restam
+  int x, y;   // canto na tela
+};
+
 /* estados para o jogo */
 enum Estado { nada, fim };
 
@@ -74,6 +88,13 @@ struct Invader {
   int valor;  // valor na árvore
   float velocidade;
   Tamanho tam;
+  int campo = -1;  // id no quadtree do campo de jogo
+  const Mascara* forma = nullptr;  // pixels do desenho, posta no canto de r
+
+  // comparação de três vias usada pela árvore (uma por nível)
+  auto operator<=> (const Invader& i) const {
+    return valor <=> i.valor;
+  }
 
   // operador de comparação na árvore
   bool operator< (const Invader& i) const {
@@ -90,24 +111,115 @@ struct Invader {
 
 };
 
+// chave do invader na árvore B
+template<>
+struct arvb_chave<Invader> {
+  int operator()(const Invader& i) const { return i.valor; }
+};
+
+// Estrutura da formação de invaders: AVL por padrão, ou árvore B quando
+// compilado com -DFORMACAO_ARVB (formações muito grandes)
+#ifdef FORMACAO_ARVB
+using Formacao = ArvB<Invader>;
+#else
+using Formacao = Abb<Invader>;
+#endif
+
+// Lote da colisão exata: float por padrão, ou ponto fixo 16.16 quando
+// compilado com -DGEOM_FIXO (mesmos acertos em qualquer máquina, para
+// replay e lockstep)
+#ifdef GEOM_FIXO
+using Lote = fixo::LoteRetangulos;
+#else
+using Lote = LoteRetangulos;
+#endif
+
+/* invader como é desenhado: o retângulo, o valor e o ramo até o pai */
+struct InvaderDesenho {
+  Retangulo r;
+  int valor;
+  bool ramo;         // false na raiz e na árvore B
+  Ponto pai, centro; // pontas do ramo
+  const Mascara* forma;
+};
+
+// Tudo o que o desenho precisa de um passo da simulação. A simulação
+// preenche um retrato por passo e a thread de desenho só lê retratos,
+// nunca o jogo.
+struct Retrato {
+  std::vector<InvaderDesenho> invaders; // na ordem de desenho
+  bool tem_destaque;                    // algum invader sob o mouse
+  Retangulo destaque;
+  Retangulo laser;
+  std::vector<Circulo> tiros;
+  std::vector<Escudo> escudos;
+  bool painel;                          // mostra o painel de tempos
+  int capturas;                         // capturas de tela pedidas até aqui
+  bool fim;                             // o jogo acabou; o desenho para
+};
+
+// painel com os tempos medidos, desenhado por cima de tudo
+const int PAINEL_LINHAS = 6;
+struct Painel {
+  char linhas[PAINEL_LINHAS][40];
+  float alt;        // altura de uma linha
+  Retangulo caixa;  // onde fica na tela
+};
+
 // Estrutura para controlar todos os objetos e estados do Jogo Centipede
 struct Jogo {
+  // passos da simulação por segundo; a cada passo tiros e laser andam uma
+  // vez e a formação anda 'velocidade' pixels
+  static constexpr double PASSOS_POR_SEGUNDO = 40;
+  // pixels que a formação desce ao bater na borda direita (não depende do
+  // passo, para a dificuldade não mudar com PASSOS_POR_SEGUNDO)
+  static constexpr int DESCIDA = 2;
+
   Estado estado;             // estado do jogo
   laser_t laser;             // laser
   std::list<tiro_t> tiros;   // tiros ativos
-
-  Abb<Invader>* invaders;     // árvore de invaders
+  Lote lote;                          // retângulos da formação no quadro
+  std::vector<Invader> lote_invaders; // invader de cada retângulo do lote
+  std::vector<bool> lote_vivo;        // false depois de atingido no quadro
+  Quadtree campo;                     // invaders no campo de jogo
+  std::vector<int> lote_indice;       // índice no lote de cada id do campo
+  std::vector<int> candidatos;        // resultado das consultas ao campo
+  std::vector<Escudo> escudos;        // escudos acima do laser
+  Mascara mascara_invader;            // pixels de um invader (20x20)
+  Mascara mascara_laser;              // pixels do laser
+  Mascara mascara_tiro;               // pixels de um tiro
+  Mascara cratera;                    // buraco que um tiro abre no escudo
+  paralelo::Triplo<Retrato> retratos; // passos da simulação para o desenho
+  std::thread desenhista;             // thread que desenha os retratos
+
+  Formacao* invaders;        // árvore de invaders
   Ponto p0;                   // ponto de referência da árvore na tela
-  int velocidade;             // velocidade de movimento 
+  int velocidade;             // velocidade de movimento, em pixels por passo
   Direcao direcao;            // direção da tela
   bool sinalNovoInvader;      // sinaliza quando adicionar um novo invader aleatório
 
+  paralelo::Pool pool;          // threads para percorrer formações grandes
   Tela tela;                    // estrutura que controla a tela
   int tecla;                 // ultima tecla apertada pelo usuario
+  struct {
+    tempo::Histograma move;     // move_figuras, a cada passo
+    tempo::Histograma desenho;  // figuras de todas as regiões sujas
+    tempo::Histograma mostra;   // Tela::mostra (cópia e troca de buffers)
+    tempo::Histograma espera;   // parado em espera_passos
+    tempo::Histograma quadro;   // de um mostra ao seguinte
+  } tempos;
+  bool painel;                  // painel de tempos ligado (tecla T)
+  int capturas;                 // capturas de tela pedidas (tecla C)
   Tamanho tamanhoTela;        // otimiza a questão do tamanho da tela
+  struct {
+    int invader, ramo, valor, destaque, laser, tiro, escudo, painel;
+  } cores;                      // índices na paleta da tela
   int pontuacao;
   int fase;
   int dificuldade;
+#ifdef ABB_ESTATISTICAS
+  AbbEstatisticas estat_quadro = {};  // contadores no início do quadro
+#endif
 
   Jogo(): pontuacao(0){}
 
@@ -115,79 +227,127 @@ struct Jogo {
   // inicia estruturas principais do jogo
   void inicia(void) {
     tela.inicia(600, 400, "AVL Invaders");
+    pool.inicia(std::thread::hardware_concurrency());
     estado = Estado::nada;
     tamanhoTela = tela.tamanho();
+    cores_inicia();
 
     invaders = nullptr;
+    quadtree_inicia(campo, Retangulo{{0, 0}, tamanhoTela});
     fase = 1;
     dificuldade = 1;
     p0.x = 0;
     p0.y = 10;
-    velocidade = 2;
+    velocidade = 1;
     sinalNovoInvader = false;
     direcao = Direcao::DIR;
+    mascaras_inicia();
     inicia_arvore();
     laser_inicia();
+    escudos_inicia();
+    painel = true;
+    capturas = 0;
     
     // cria gerador aleatório de numeros de 0 a 100
     auto seed = std::chrono::high_resolution_clock::now().time_since_epoch().count();
     srand(seed);
   }
 
+  // converte as cores do jogo uma vez só
+  void cores_inicia(void) {
+    cores.invader = tela.paleta(Cor{1, 0.2, 0});
+    cores.ramo = tela.paleta(Cor{0.2, 0.3, 0.8});
+    cores.valor = tela.paleta(Cor{0, 0, 0});
+    cores.destaque = tela.paleta(Cor{0.2, 0.9, 0.6});
+    cores.laser = tela.paleta(Cor{1, 0, 0});
+    cores.tiro = tela.paleta(Cor{1, 0, 0});
+    cores.escudo = tela.paleta(Cor{0.2, 0.9, 0.6});
+    cores.painel = tela.paleta(Cor{0.9, 0.9, 0.9});
+  }
+
+  // Monta as máscaras das figuras. Não mudam depois, então a thread de
+  // desenho pode lê-las pelos retratos.
+  void mascaras_inicia(void) {
+    mascara_desenho(mascara_invader, {"..################..",
+                                      ".##################.",
+                                      "####################",
+                                      "####################",
+                                      "####################",
+                                      "####################",
+                                      "####################",
+                                      "####################",
+                                      "####################",
+                                      "####################",
+                                      "####################",
+                                      "####################",
+                                      "####################",
+                                      "####################",
+                                      "###.####....####.###",
+                                      "##..###......###..##",
+                                      "##..##........##..##",
+                                      "#...##........##...#",
+                                      "#....#........#....#",
+                                      "#....#........#....#"});
+    mascara_cheia(mascara_laser, 10, 20);  // o tamanho de laser.ret
+    mascara_circulo(mascara_tiro, 5);
+    mascara_circulo(cratera, 7);
+  }
+
   void inicia_arvore(void){
     std::vector<int> valores {25, 75, 15, 35, 85, 65  };
     Invader i1;
+    i1.forma = &mascara_invader;
 
     // raiz
     i1.r = {{290, 0}, {20, 20}};
     i1.valor = 50;
-    invaders = abb_insere( invaders, i1 );
+    formacao_insere( i1 );
     
     // nodos, posicionamento definido mais tarde
     for(int& v: valores) {
       i1.r = {{0, 0}, {20, 20}};
       i1.valor = v;
-      invaders = abb_insere( invaders, i1 );
+      formacao_insere( i1 );
     }
   }  
 
-  bool intercr(Retangulo r1, Retangulo r2){
-    if (r1.pos.x < r2.pos.x + r2.tam.larg &&
-        r1.pos.x + r1.tam.larg > r2.pos.x &&
-        r1.pos.y < r2.pos.y + r2.tam.alt &&
-        r1.pos.y + r1.tam.alt > r2.pos.y) {
-        return true;
-    }
-    return false;
-}
-
-bool intercr(Circulo c, Retangulo r){
-    
-    float closestX = std::max(r.pos.x, std::min(c.centro.x, r.pos.x + r.tam.larg));
-    float closestY = std::max(r.pos.y, std::min(c.centro.y, r.pos.y + r.tam.alt));
-
-  
-    float distanceX = c.centro.x - closestX;
-    float distanceY = c.centro.y - closestY;
-
-    return (distanceX * distanceX + distanceY * distanceY) < (c.raio * c.raio);
-}
+  // insere um invader na formação
+  void formacao_insere(const Invader& i) {
+#ifdef FORMACAO_ARVB
+    invaders = arvb_insere( invaders, i );
+#else
+    invaders = abb_insere( invaders, i );
+#endif
+  }
 
+  // remove um invader da formação
+  void formacao_remove(const Invader& i) {
+#ifdef FORMACAO_ARVB
+    invaders = arvb_remove( invaders, i );
+#else
+    invaders = abb_remove( invaders, i );
+#endif
+  }
 
-  void tiro_vereficar_intercerpcao(){
-    //testa a colisao entre o objeto e o tiro 
+  // invader da raiz da formação (a formação não pode estar vazia)
+  Invader& formacao_raiz(void) {
+#ifdef FORMACAO_ARVB
+    return invaders->dados[0];
+#else
+    return invaders->dado;
+#endif
+  }
 
-    if(tiros.empty() == false){
-      for(auto t = tiros.begin(); t != tiros.end(); t++){
-        auto v = verifica_intercep_abb(invaders, *t);
-        if( v != nullptr){
-          invaders = abb_remove(invaders, *v);
-          pontuacao = v->valor;  //Atualiza a pontuacao
-        }
-      }
-    }
+  // aplica f a cada invader da formação
+  template<typename F>
+  void formacao_percorre(F&& f) {
+#ifdef FORMACAO_ARVB
+    arvb_percorre( invaders, f );
+#else
+    abb_percorre( invaders, f );
+#endif
   }
-   
+
   void atualizarPontuacao(int valor){
     pontuacao += valor;
   }
@@ -201,42 +361,29 @@ bool intercr(Circulo c, Retangulo r){
 }
 
 void aumenta_dificuldade_recursivo(Abb<Invader>* a) {
-  if (a == nullptr) {
-    return;
-  }
   // Aumenta a velocidade dos invaders de acordo com a dificuldade
-  a->dado.velocidade *= dificuldade;
-  aumenta_dificuldade_recursivo(a->esq);
-  aumenta_dificuldade_recursivo(a->dir);
+  abb_percorre_paralelo(a, [this](Invader& i) { i.velocidade *= dificuldade; }, pool);
 }
 
   void verifica_termino(Jogo& jogo){
     if(jogo.invaders == nullptr){
       jogo.estado = Estado::fim;
       std::cout<< "Você venceuu!!"<< std::endl;
-    }else if(jogo.invaders->dado.r.pos.y >= jogo.tamanhoTela.alt){
+    }else if(jogo.formacao_raiz().r.pos.y >= jogo.tamanhoTela.alt){
       jogo.estado = Estado::fim;
       std::cout << "************"<< std::endl;
 
 
     }
   }
-  // Verifica se um invasor atingiu o jogador
-Invader* verifica_colisao_jogador(Abb<Invader>* a, laser_t& l)
-{
-    if(a == nullptr)
-        return nullptr;
-
-    if(intercr(l.ret, a->dado.r))
-        return &a->dado;
-    else {
-        Invader* ret = verifica_colisao_jogador(a->esq, l);
-        if(ret != nullptr)
-            return ret;
-        ret = verifica_colisao_jogador(a->dir, l);
-        return ret;
-    }
-}
+  // custo do último quadro desenhado: conversões de cor, trocas pela
+  // paleta, chamadas ao allegro e vértices dos lotes
+  void mostra_custo(std::ostream& os) {
+    TelaCusto c = tela.custo();
+    os << "[tela quadro] conversoes " << c.conversoes << " | trocas " << c.trocas
+       << " | chamadas " << c.chamadas << " | vertices " << c.vertices
+       << " | " << c.ms << " ms" << std::endl;
+  }
 
   void exibirPontuacao(){
     std::cout<<"Pontuação total:  "<<pontuacao << std::endl;
@@ -258,7 +405,69 @@ Invader* verifica_colisao_jogador(Abb<Invader>* a, laser_t& l)
   void finaliza(void) {
     // fecha a tela
     tela.finaliza();
-    abb_destroi( invaders );
+#ifdef FORMACAO_ARVB
+    arvb_destroi( invaders );
+#else
+    abb_destroi_paralelo( invaders, pool );
+#endif
+    pool.finaliza();
+#ifdef ABB_ESTATISTICAS
+    abb_estat_mostra(std::cerr, "total");
+#endif
+  }
+
+  // cria os escudos, espalhados acima do laser
+  void escudos_inicia(void) {
+    Escudo e;
+    mascara_desenho(e.m, {"......################......",
+                          "....####################....",
+                          "..########################..",
+                          ".##########################.",
+                          "############################",
+                          "############################",
+                          "############################",
+                          "############################",
+                          "############################",
+                          "########............########",
+                          "#######..............#######",
+                          "######................######"});
+    escudos.clear();
+    const int n = 4;
+    for(int k = 0; k < n; k++) {
+      e.x = (tamanhoTela.larg * (2*k + 1)) / (2*n) - e.m.larg / 2;
+      e.y = tamanhoTela.alt - 70;
+      escudos.push_back(e);
+    }
+  }
+
+  // Testa o tiro contra os escudos no caminho do passo anterior até a
+  // posição atual, em passos do raio para não atravessar um escudo fino.
+  // Se acertar, abre uma cratera no escudo e retorna true.
+  bool tiro_escudo(const tiro_t& t) {
+    int r = mascara_tiro.larg / 2;
+    for(float dy = t.v; ; dy -= std::max(r, 1)) {
+      if( dy < 0 )
+        dy = 0;
+      int x = (int)t.c.centro.x - r, y = (int)(t.c.centro.y + dy) - r;
+      for(Escudo& e : escudos)
+        if( mascara_toca(e.m, e.x, e.y, mascara_tiro, x, y) ) {
+          mascara_apaga(e.m, e.x, e.y, cratera, x + r - cratera.larg / 2,
+                        y + r - cratera.alt / 2);
+          return true;
+        }
+      if( dy == 0 )
+        return false;
+    }
+  }
+
+  // desenha os escudos, um retângulo por trecho de pixels de cada linha
+  void escudos_desenha(const std::vector<Escudo>& escudos) {
+    tela.cor(cores.escudo);
+    for(const Escudo& e : escudos)
+      if(tela.visivel(mascara_caixa(e.m, e.x, e.y)))
+        mascara_trechos(e.m, [&](int x0, int x1, int y) {
+          tela.retangulo(Retangulo{{float(e.x + x0), float(e.y + y)}, {float(x1 - x0), 1}});
+        });
   }
 
   // move o tiro (se existir) em certa velocidade
@@ -284,14 +493,13 @@ Invader* verifica_colisao_jogador(Abb<Invader>* a, laser_t& l)
     tiros.push_back(tiro);
   }
 
- // desenha o tiro, sendo que a cada desenha sua cor muda.
-  void tiro_desenha(void) {
+ // desenha os tiros
+  void tiro_desenha(const std::vector<Circulo>& tiros) {
     if (tiros.empty() == false) {
-      for(auto t = tiros.begin(); t != tiros.end(); t++){
-        Cor outra = {1.0, 0.0, 0.0};
-        tela.cor(outra);
-        tela.circulo((*t).c);
-      }
+      tela.cor(cores.tiro);
+      for(const Circulo& c : tiros)
+        if(tela.visivel(caixa(c)))
+          tela.circulo(c);
     }
   }
 
@@ -331,103 +539,218 @@ Invader* verifica_colisao_jogador(Abb<Invader>* a, laser_t& l)
   }
 
   // desenha o laser
-  void laser_desenha(void) {
-    Cor vermelho = {1.0, 0.0, 0.0};
-    tela.cor(vermelho);
-    tela.retangulo(laser.ret);
+  void laser_desenha(Retangulo r) {
+    tela.cor(cores.laser);
+    tela.retangulo(r);
   }
 
-  // Desenha a arvore baseado em divisão geométrica.
-  void desenha_arvore(Abb<Invader>* a, Ponto p) {
-    const Cor azul = {0.2, 0.3, 0.8};
-    const Cor preto = {0, 0, 0};
-    const Cor vermelho = {1, 0.2, 0};
-    static char valor[10];
-
+  // Retrata a arvore baseado em divisão geométrica: cada invader com o
+  // ramo que vem do pai, na ordem em que são desenhados.
+  void retrata_arvore(Retrato& r, Abb<Invader>* a, const Invader* pai) {
     if(a == nullptr)
       return;
-    tela.cor(vermelho);            
-    tela.retangulo(a->dado.r);
-    // desenha valor do nó
-    tela.cor(preto);
-    sprintf(valor, "%d", a->dado.valor);
-    tela.texto(a->dado.r.pos, valor);
+    InvaderDesenho d{a->dado.r, a->dado.valor, pai != nullptr, {}, {}, a->dado.forma};
     // ajusta a linha para ficar no meio do retangulo
-    tela.cor(azul); 
-    tela.linha(
-      Ponto{p.x+a->dado.r.tam.larg/2, p.y+a->dado.r.tam.alt/2}, 
-      Ponto{a->dado.r.pos.x+a->dado.r.tam.larg/2, a->dado.r.pos.y+a->dado.r.tam.alt/2}
-      );
-    desenha_arvore(a->esq, a->dado.r.pos);
-    desenha_arvore(a->dir, a->dado.r.pos);
-  }
-
-  // Desenha a arvore baseado em divisão geométrica.
-  void desenha_arvore(Abb<Invader>* a) {
-    char valor[10];
-    //const Cor azul = {0.2, 0.3, 0.8};
-    const Cor preto = {0, 0, 0};
-    const Cor vermelho = {1, 0.2, 0};
+    if(pai != nullptr) {
+      d.pai = Ponto{pai->r.pos.x+a->dado.r.tam.larg/2, pai->r.pos.y+a->dado.r.tam.alt/2};
+      d.centro = Ponto{a->dado.r.pos.x+a->dado.r.tam.larg/2, a->dado.r.pos.y+a->dado.r.tam.alt/2};
+    }
+    r.invaders.push_back(d);
+    retrata_arvore(r, a->esq, &a->dado);
+    retrata_arvore(r, a->dir, &a->dado);
+  }
 
-    if(a == nullptr)
+  void retrata_arvore(Retrato& r, Abb<Invader>* a) {
+    retrata_arvore(r, a, nullptr);
+  }
+
+  // Escreve o valor de cada invader. Fica depois de todas as figuras: o
+  // texto descarrega o lote da tela, então as figuras saem em uma só
+  // chamada e os números em outra.
+  void desenha_valores(const Retrato& r) {
+    tela.cor(cores.valor);
+    for(const InvaderDesenho& i : r.invaders)
+      if(tela.visivel(i.r))
+        tela.numero(i.r.pos, i.valor);
+  }
+
+  // desenha o invader com a forma que as colisões usam
+  void invader_desenha(const InvaderDesenho& i) {
+    if(i.forma == nullptr) {
+      tela.retangulo(i.r);
       return;
-      // desenha figura
-    tela.cor(vermelho);      
-    tela.retangulo(a->dado.r);
-    // desenha o valor 
-    tela.cor(preto);
-    sprintf(valor, "%d", a->dado.valor);
-    tela.texto(a->dado.r.pos, valor);
-    // faz desenho recursivamente
-    desenha_arvore(a->esq, a->dado.r.pos);
-    desenha_arvore(a->dir, a->dado.r.pos);
-  }
-
-  // desenha todas as figuras e objetos na tela
-  void desenha_figuras() {
-    //Cor azul = {0.2, 0.3, 0.8};
-    // Cor vermelho = {1, 0.2, 0};
-    // Cor verde = {0.2, 0.9, 0.6};
-    // Cor preto = {0, 0, 0};
-
-    // mudar cor da tela
-    //tela.cor(azul);
-
-    desenha_arvore( invaders );
+    }
+    int x = (int)i.r.pos.x, y = (int)i.r.pos.y;
+    mascara_trechos(*i.forma, [&](int x0, int x1, int l) {
+      tela.retangulo(Retangulo{{float(x + x0), float(y + l)}, {float(x1 - x0), 1}});
+    });
+  }
+
+  // caixa do ramo entre os pontos a e b
+  static Retangulo caixa_ramo(Ponto a, Ponto b) {
+    return Retangulo{{std::min(a.x, b.x), std::min(a.y, b.y)},
+                     {std::abs(a.x - b.x), std::abs(a.y - b.y)}};
+  }
+
+  // Desenha as figuras de um retrato que tocam a região sendo refeita
+  // (ver Tela::visivel); as outras ficam como estão na tela.
+  void desenha_figuras(const Retrato& r) {
+    for(const InvaderDesenho& i : r.invaders) {
+      if(tela.visivel(i.r)) {
+        tela.cor(cores.invader);
+        invader_desenha(i);
+      }
+      if(i.ramo && tela.visivel(caixa_ramo(i.pai, i.centro))) {
+        tela.cor(cores.ramo);
+        tela.linha(i.pai, i.centro);
+      }
+    }
+    desenha_valores(r);
+    // destaca o invader sob o cursor do mouse
+    if(r.tem_destaque && tela.visivel(r.destaque)) {
+      tela.cor(cores.destaque);
+      tela.retangulo(r.destaque);
+    }
+    escudos_desenha(r.escudos);
 
     // desenha laser e tiro
-    laser_altera_velocidade();
-    laser_atira();
-    laser_desenha();
-    tiro_desenha();
+    if(tela.visivel(r.laser))
+      laser_desenha(r.laser);
+    tiro_desenha(r.tiros);
   }
 
-  // realiza um percurso em largura
-  Invader* verifica_intercep_abb(Abb<Invader>* a, tiro_t t)
-  {
-    Invader* ret = nullptr;
-    if(a == nullptr)
-      return nullptr;
+  // copia os retângulos da formação para o lote e atualiza a posição de
+  // cada invader no campo (só troca de nó quem saiu da sua célula)
+  void prepara_colisao(void) {
+    lote_limpa( lote );
+    lote_invaders.clear();
+    std::fill( lote_indice.begin(), lote_indice.end(), -1 );
+    formacao_percorre([this](Invader& i) {
+      if( i.campo < 0 )
+        i.campo = quadtree_insere( campo, i.r );
+      else
+        quadtree_move( campo, i.campo, i.r );
+      if( i.campo >= (int)lote_indice.size() )
+        lote_indice.resize( i.campo + 1, -1 );
+      lote_indice[i.campo] = lote_tamanho( lote );
+      lote_insere( lote, i.r );
+      lote_invaders.push_back( i );
+    });
+    lote_vivo.assign( lote_invaders.size(), true );
+  }
 
-    if( intercr( t.c, a->dado.r ) )
-      return &a->dado;
-    else {
-      ret = verifica_intercep_abb(a->esq, t);
-      if(ret != nullptr)
-        return ret;
-      ret = verifica_intercep_abb(a->dir, t);
+  // índice no lote de um id do campo, ou -1 se o invader já foi atingido
+  int campo_lote(int id) const {
+    int i = lote_indice[id];
+    return ( i >= 0 && lote_vivo[i] ) ? i : -1;
+  }
+
+  // Área das consultas ao campo. Em ponto fixo o campo (em float) só
+  // escolhe os candidatos e o teste exato é feito no lote, então a área
+  // cresce um pixel para um arredondamento não esconder um toque.
+  static Retangulo area_consulta(Retangulo r) {
+#ifdef GEOM_FIXO
+    return Retangulo{{r.pos.x - 1, r.pos.y - 1}, {r.tam.larg + 2, r.tam.alt + 2}};
+#else
+    return r;
+#endif
+  }
+
+  // instante em que o círculo c, andando d, toca o invader i do lote, ou
+  // negativo se não tocar
+  float impacto_lote(Circulo c, Ponto d, int i) const {
+#ifdef GEOM_FIXO
+    return fixo::real( fixo::tempo_impacto( fixo::converte(c), fixo::converte(d),
+                                            fixo::lote_retangulo(lote, i) ) );
+#else
+    return tempo_impacto( c, d, lote_retangulo(lote, i) );
+#endif
+  }
+
+  // Índice do primeiro invader ainda na formação (na ordem do lote) que
+  // toca o retângulo r, ou -1. Só visita os nós do campo perto de r; quem
+  // toca o retângulo ainda tem que tocar os pixels m, postos no canto de r.
+  int colisao_retangulo(Retangulo r, const Mascara& m) {
+    int k = -1;
+    quadtree_consulta( campo, area_consulta(r), candidatos );
+    for( int id : candidatos ) {
+      int i = campo_lote( id );
+      if( i >= 0 && (k < 0 || i < k) && interrr_lote_um( r, lote, i ) &&
+          invader_toca( i, m, (int)r.pos.x, (int)r.pos.y ) )
+        k = i;
+    }
+    return k;
+  }
+
+  // true se os pixels do invader i do lote tocam m, posta em (x, y)
+  bool invader_toca(int i, const Mascara& m, int x, int y) const {
+    const Invader& v = lote_invaders[i];
+    if( v.forma == nullptr )
+      return true;
+    return mascara_toca( *v.forma, (int)v.r.pos.x, (int)v.r.pos.y, m, x, y );
+  }
+
+  // idem para o invader sob o ponto p (o cursor do mouse)
+  int colisao_ponto(Ponto p) {
+    int k = -1;
+    quadtree_ponto( campo, p, candidatos );
+    for( int id : candidatos ) {
+      int i = campo_lote( id );
+      if( i >= 0 && (k < 0 || i < k) )
+        k = i;
+    }
+    return k;
+  }
+
+  // índice do invader que o círculo c toca primeiro ao andar d, ou -1.
+  // Testa o caminho inteiro, então um tiro rápido não atravessa um invader
+  // entre dois passos.
+  int colisao_varrida(Circulo c, Ponto d) {
+    int k = -1;
+    float tk = 2;
+    quadtree_consulta( campo, area_consulta(caixa_varrida(c, d)), candidatos );
+    for( int id : candidatos ) {
+      int i = campo_lote( id );
+      if( i < 0 )
+        continue;
+      float t = impacto_lote( c, d, i );
+      if( t < 0 )
+        continue;
+      // o retângulo só escolhe os candidatos; o instante vale dos pixels
+      const Invader& v = lote_invaders[i];
+      if( v.forma != nullptr ) {
+        int r = mascara_tiro.larg / 2;
+        t = mascara_varrida( *v.forma, (int)v.r.pos.x, (int)v.r.pos.y, mascara_tiro,
+                             c.centro.x - r, c.centro.y - r, d.x, d.y );
+      }
+      if( t >= 0 && (t < tk || (t == tk && i < k)) ) {
+        k = i;
+        tk = t;
+      }
     }
-      
-    return ret;
+    return k;
   }
 
   void tiro_verifica_interceptacao(void){
-    // testa por uma colisão entre objetos e o tiro
+    // testa por uma colisão entre objetos e o tiro, no caminho que o tiro
+    // fez desde o passo anterior (tiro_movimenta já o levou para cima)
+    prepara_colisao();
     if (tiros.empty() == false) {
-      for( auto t = tiros.begin(); t != tiros.end(); t++ ) {
-        auto v = verifica_intercep_abb(invaders, *t);
-        if( v != nullptr )
-          invaders = abb_remove(invaders, *v );
+      for( auto t = tiros.begin(); t != tiros.end(); ) {
+        // os escudos ficam entre o laser e a formação
+        if( tiro_escudo(*t) ) {
+          t = tiros.erase(t);
+          continue;
+        }
+        Circulo antes = (*t).c;
+        antes.centro.y += (*t).v;
+        int k = colisao_varrida( antes, Ponto{0, -(*t).v} );
+        if( k >= 0 ) {
+          lote_vivo[k] = false;
+          quadtree_remove( campo, lote_invaders[k].campo );
+          formacao_remove( lote_invaders[k] );
+        }
+        t++;
       } // for tiros
     } // if tiros
   }
@@ -435,47 +758,98 @@ Invader* verifica_colisao_jogador(Abb<Invader>* a, laser_t& l)
 //Função que manipula a arvore depois de um tiro acerta um invasor
 
 
-  // Move/posiciona a arvore baseado em divisão geométrica.
-  // - A raiz é dividida em 2 partes, uma para cada sub-árvore
-  // - Recursivamente, divide espaços da tela no eixo X em 2
-  void move_arvore(Abb<Invader>* a, int x0, int x1, int y0) {
-    if(a == nullptr)
-      return;
-    a->dado.r.pos.x = p0.x +  x0 + (x1-x0)/2 - 10;
-    a->dado.r.pos.y = p0.y + y0;  
-    
-    
+  // Retorna a nova direção se o retângulo r bater em uma das bordas, ou 0.
+  // Não altera o jogo, para poder ser chamada de várias threads.
+  int verifica_borda(Retangulo r) const {
+    if( (r.pos.x+r.tam.larg+velocidade*direcao) >= tamanhoTela.larg )
+      return Direcao::ESQ;  // bate na direita
+    else if ( (r.pos.x-r.tam.larg+velocidade*direcao) <=  0 ) 
+      return Direcao::DIR;  // bate na esquerda
+    return 0;
+  }
 
-    if( (a->dado.r.pos.x+a->dado.r.tam.larg+velocidade*direcao) >= tamanhoTela.larg )
-    {
-      // bate na direita
-      direcao = Direcao::ESQ;
-      p0.y = p0.y + velocidade;
-      // avisa flag de criar novo invaders na próxima vez
-      sinalNovoInvader = true;
-    } else if ( (a->dado.r.pos.x-a->dado.r.tam.larg+velocidade*direcao) <=  0 ) 
-    {
-      // bate na esquerda
-      direcao = Direcao::DIR;
+  // Troca a direção da formação depois de uma batida na borda
+  void aplica_borda(int d) {
+    if( d == Direcao::ESQ )
+      p0.y = p0.y + DESCIDA;
+    if( d != 0 ) {
+      direcao = (Direcao) d;
       // avisa flag de criar novo invaders na próxima vez
       sinalNovoInvader = true;
     }
+  }
 
-    move_arvore(a->esq, x0, x0+(x1-x0)/2, y0+30);
-    move_arvore(a->dir, x0+(x1-x0)/2, x1, y0+30);
+  // Move/posiciona a arvore baseado em divisão geométrica.
+  // - A raiz é dividida em 2 partes, uma para cada sub-árvore
+  // - Recursivamente, divide espaços da tela no eixo X em 2
+  // - Subárvores grandes são posicionadas em paralelo
+  // Retorna a batida na borda (ver verifica_borda) de algum nó.
+  int move_arvore(Abb<Invader>* a, unsigned vaga) {
+    if(a == nullptr)
+      return 0;
+    // posição da vaga vem da tabela montada em tempo de compilação
+    Ponto v = formacao_vaga( vaga );
+    a->dado.r.pos.x = p0.x + v.x;
+    a->dado.r.pos.y = p0.y + v.y;
+    int d = verifica_borda( a->dado.r );
+
+    int de, dd;
+    if( a->altura >= ABB_ALTURA_PARALELA )
+      pool.divide([&] { de = move_arvore(a->esq, 2*vaga); },
+                  [&] { dd = move_arvore(a->dir, 2*vaga + 1); });
+    else {
+      de = move_arvore(a->esq, 2*vaga);
+      dd = move_arvore(a->dir, 2*vaga + 1);
+    }
+    return d ? d : (de ? de : dd);
   }
 
-  void move_arvore(Abb<Invader>* a) 
+  void move_arvore(Formacao* a) 
   {
     p0.x = p0.x + velocidade * direcao;
-    move_arvore( invaders, 0, 600, 0 );
+#ifdef FORMACAO_ARVB
+    aplica_borda( move_arvore( invaders, 0, FORMACAO_LARGURA, 0 ) );
+#else
+    aplica_borda( move_arvore( invaders, 1u ) );
+#endif
   }
-   void manipula_arvore(Abb<Invader>*& a, const Invader& invader){
-   a = abb_remove(a, invader);
-   aumenta_dificuldade_recursivo(a);
 
-}
+#ifdef FORMACAO_ARVB
+  // Versões para a árvore B: os invaders de um nó ficam lado a lado no
+  // espaço [x0,x1] e os n+1 filhos dividem esse espaço na linha de baixo.
+  int move_arvore(ArvB<Invader>* a, int x0, int x1, int y0) {
+    int d = 0;
+    if(a == nullptr)
+      return d;
+    int larg = (x1 - x0) / a->n;
+    for(int i = 0; i < a->n; i++) {
+      a->dados[i].r.pos.x = p0.x + x0 + larg*i + larg/2 - 10;
+      a->dados[i].r.pos.y = p0.y + y0;
+      if( d == 0 )
+        d = verifica_borda( a->dados[i].r );
+    }
+    if(a->folha)
+      return d;
+    larg = (x1 - x0) / (a->n + 1);
+    for(int i = 0; i <= a->n; i++) {
+      int df = move_arvore(a->filhos[i], x0 + larg*i, x0 + larg*(i+1), y0+30);
+      if( d == 0 )
+        d = df;
+    }
+    return d;
+  }
+
+  void retrata_arvore(Retrato& r, ArvB<Invader>* a) {
+    arvb_percorre(a, [&](Invader& i) {
+      r.invaders.push_back(InvaderDesenho{i.r, i.valor, false, {}, {}, i.forma});
+    });
+  }
 
+  void aumenta_dificuldade_recursivo(ArvB<Invader>* a) {
+    arvb_percorre(a, [this](Invader& i) { i.velocidade *= dificuldade; });
+  }
+
+#endif
   void avanca_fase() {
   if (invaders == nullptr) {
     // O jogador ganhou a fase, avança para a próxima
@@ -487,18 +861,34 @@ Invader* verifica_colisao_jogador(Abb<Invader>* a, laser_t& l)
   }
 }
   // Cria um novo invader e insere na árvore. O valor aleatório
-  // fica entre [0,100]. 
-  // - Se a direção é direita, insere na sub-árvore da direita 
-  // - Se a direção é esquerda, insere na sub-árvore da esquerda
+  // fica entre [0,100). 
+  // - Se a direção é direita, o valor é maior que o da raiz e a busca
+  //   começa na sub-árvore da direita 
+  // - Se a direção é esquerda, o valor é menor que o da raiz e a busca
+  //   começa na sub-árvore da esquerda
+  // A inserção com dica mantém a ordem e o balanceamento da árvore toda.
   void cria_novo_invader(void)
   {
     Invader i1;
     i1.r = {{0, 0}, {20, 20}};
+    i1.forma = &mascara_invader;
     i1.valor = rand() % 100;
-    if( direcao ==  Direcao::DIR )
-      invaders->dir = abb_insere( invaders->dir, i1 );
-    else
-      invaders->esq = abb_insere( invaders->esq, i1 );
+#ifdef FORMACAO_ARVB
+    // na árvore B a posição depende só da chave
+    formacao_insere( i1 );
+#else
+    if( invaders == nullptr )
+      formacao_insere( i1 );
+    else {
+      int raiz = invaders->dado.valor;
+      if( direcao == Direcao::DIR && raiz < 99 )
+        i1.valor = raiz + 1 + rand() % (99 - raiz);
+      else if( direcao == Direcao::ESQ && raiz > 0 )
+        i1.valor = rand() % raiz;
+      Abb<Invader>* dica = (direcao == Direcao::DIR) ? invaders->dir : invaders->esq;
+      invaders = abb_insere_dica( invaders, dica, i1 );
+    }
+#endif
     sinalNovoInvader = false;
   }
 
@@ -523,72 +913,260 @@ Invader* verifica_colisao_jogador(Abb<Invader>* a, laser_t& l)
     std::cout << "Pressione: " << std::endl;
     std::cout << " - 'a' ou 'd' para mover " << std::endl;
     std::cout << " - 'f' para atirar " << std::endl;
+    std::cout << " - 't' mostra ou esconde os tempos " << std::endl;
+    std::cout << " - 'c' grava a tela em captura_NNN.ppm " << std::endl;
     std::cout << " - 'q' sair" << std::endl;
   }
 
-  // atualiza o jogo, como se fosse um passo na execução
+  // Um passo da simulação, chamado PASSOS_POR_SEGUNDO vezes por segundo
+  // qualquer que seja o tempo gasto no desenho.
   void atualiza(void) {
-    // le ultima tecla
-    tecla = tela.tecla();
-    // tecla Q termina
-    if (tecla != ALLEGRO_KEY_Q) {
-      // faz o resto
-      move_figuras();
-      avanca_fase();      
-      tela.limpa();
-      desenha_figuras();
-      tela.mostra();
-      // espera 60 ms antes de atualizar a tela
-      tela.espera(20);
+    // trata, na ordem, todas as teclas apertadas desde o passo anterior
+    EventoTecla e;
+    while (tela.proximo_evento(e)) {
+      if (!e.desce)
+        continue;
+      tecla = e.tecla;
+      // tecla Q termina
+      if (tecla == ALLEGRO_KEY_Q) {
+        // troca estado do jogo para terminado
+        estado = Estado::fim;
+        return;
+      }
+      // tecla T liga e desliga o painel de tempos
+      if (tecla == ALLEGRO_KEY_T)
+        painel = !painel;
+      // tecla C grava a tela do próximo quadro
+      if (tecla == ALLEGRO_KEY_C)
+        capturas++;
+      laser_altera_velocidade();
+      laser_atira();
+    }
+    double t0 = tempo::agora();
+    move_figuras();
+    tempo::histograma_anota(tempos.move, tempo::agora() - t0);
+    avanca_fase();
+    atualizarPontuacao(1);
 
-        
-    } else {
-      // troca estado do jogo para terminado
+    // Verifica se algum invader atingiu o jogador
+    if( colisao_retangulo(laser.ret, mascara_laser) >= 0 ) {
       estado = Estado::fim;
+      std::cout << "Você perdeu!\n";
+      return;
     }
-  }  
-
+    verifica_termino(*this);
+  }
 
+  // Retrata o estado atual para a thread de desenho. Nunca espera por
+  // ela: um retrato que ela não chegou a pegar é trocado pelo novo.
+  void retrata(void) {
+    Retrato& r = retratos.escreve();
+    r.invaders.clear();
+    retrata_arvore(r, invaders);
+    int k = colisao_ponto( tela.rato() );
+    r.tem_destaque = k >= 0;
+    if( k >= 0 )
+      r.destaque = lote_invaders[k].r;
+    r.laser = laser.ret;
+    r.tiros.clear();
+    for(const tiro_t& t : tiros)
+      r.tiros.push_back(t.c);
+    r.escudos = escudos;
+    r.painel = painel;
+    r.capturas = capturas;
+    r.fim = verifica_fim();
+    retratos.publica();
+  }
 
-  void atualiza_jogo(Jogo& jogo){
-  jogo.tecla = jogo.tela.tecla();
-  jogo.tela.limpa();
+  // caixa de todos os invaders do retrato
+  static Retangulo caixa_formacao(const Retrato& r) {
+    Retangulo f{{0, 0}, {0, 0}};
+    for(size_t k = 0; k < r.invaders.size(); k++)
+      f = k ? uniao(f, r.invaders[k].r) : r.invaders[k].r;
+    return f;
+  }
 
-  jogo.laser_move();
-  jogo.tiro_movimenta();
-  jogo.tiro_verifica_interceptacao();
+  static bool iguais(Retangulo a, Retangulo b) {
+    return a.pos.x == b.pos.x && a.pos.y == b.pos.y &&
+           a.tam.larg == b.tam.larg && a.tam.alt == b.tam.alt;
+  }
 
-  if(jogo.sinalNovoInvader){
-    Invader invader;
-    invader.r = {{0.0}, {20,20}};
-    invader.valor = rand()% 100;
-    jogo.invaders = abb_insere(jogo.invaders, invader);
-    jogo.sinalNovoInvader = false;
+  // true se a formação sai igual nos dois retratos
+  static bool formacao_igual(const Retrato& r, const Retrato& a) {
+    if( r.invaders.size() != a.invaders.size() )
+      return false;
+    for(size_t k = 0; k < r.invaders.size(); k++) {
+      const InvaderDesenho &i = r.invaders[k], &j = a.invaders[k];
+      if( !iguais(i.r, j.r) || i.valor != j.valor || i.ramo != j.ramo ||
+          i.pai.x != j.pai.x || i.pai.y != j.pai.y ||
+          i.centro.x != j.centro.x || i.centro.y != j.centro.y )
+        return false;
+    }
+    return true;
   }
-  jogo.laser_desenha();
-  jogo.tiro_desenha();
-  jogo.desenha_arvore(jogo.invaders);
 
-    // Verifica se algum invader atingiu o jogador
-  if(jogo.verifica_colisao_jogador(jogo.invaders, jogo.laser) != nullptr) {
-    jogo.estado = Estado::fim;
-    std::cout << "Você perdeu!\n";
-    return;
+  // Marca na tela o que mudou do retrato desenhado antes (a) para o atual
+  // (r): cada figura que mudou suja a caixa onde estava e a caixa onde
+  // está.
+  void marca_sujos(const Retrato& r, const Retrato& a) {
+    // a formação anda quase todo passo; parada, só o destaque pode mudar
+    if( !formacao_igual(r, a) ) {
+      tela.suja(caixa_formacao(a));
+      tela.suja(caixa_formacao(r));
+    } else if( r.tem_destaque != a.tem_destaque ||
+               (r.tem_destaque && !iguais(r.destaque, a.destaque)) ) {
+      if( a.tem_destaque )
+        tela.suja(a.destaque);
+      if( r.tem_destaque )
+        tela.suja(r.destaque);
+    }
+
+    if( r.laser.pos.x != a.laser.pos.x || r.laser.pos.y != a.laser.pos.y ) {
+      tela.suja(a.laser);
+      tela.suja(r.laser);
+    }
+    for(const Circulo& c : a.tiros)
+      tela.suja(caixa(c));
+    for(const Circulo& c : r.tiros)
+      tela.suja(caixa(c));
+    // escudo que perdeu pixels
+    for(size_t k = 0; k < r.escudos.size() && k < a.escudos.size(); k++)
+      if( r.escudos[k].m.bits != a.escudos[k].m.bits )
+        tela.suja(mascara_caixa(r.escudos[k].m, r.escudos[k].x, r.escudos[k].y));
   }
 
-  verifica_termino(jogo);
+  // Escreve os percentis de cada tempo no painel, no canto superior
+  // direito da tela
+  void painel_monta(Painel& p) {
+    const char* nomes[] = {"move", "desenho", "mostra", "espera", "quadro"};
+    const tempo::Histograma* hs[] = {&tempos.move, &tempos.desenho, &tempos.mostra,
+                                     &tempos.espera, &tempos.quadro};
+    std::snprintf(p.linhas[0], sizeof p.linhas[0], "%-7s%6s%6s%6s%6s", "ms", "p50", "p95",
+                  "p99", "max");
+    for(int k = 0; k < PAINEL_LINHAS - 1; k++)
+      std::snprintf(p.linhas[k + 1], sizeof p.linhas[k + 1], "%-7s%6.2f%6.2f%6.2f%6.2f",
+                    nomes[k], tempo::histograma_percentil(*hs[k], 0.50),
+                    tempo::histograma_percentil(*hs[k], 0.95),
+                    tempo::histograma_percentil(*hs[k], 0.99),
+                    tempo::histograma_max(*hs[k]));
+    int larg = 0;
+    for(int k = 0; k < PAINEL_LINHAS; k++)
+      larg = std::max(larg, tela.strlen(p.linhas[k]));
+    p.alt = tela.tamanho_texto(p.linhas[0]).alt;
+    p.caixa = Retangulo{{tamanhoTela.larg - larg - 9, 5},
+                        {float(larg + 4), PAINEL_LINHAS * p.alt + 4}};
+  }
 
-  jogo.tela.mostra();
-}
+  static bool painel_igual(const Painel& a, const Painel& b) {
+    for(int k = 0; k < PAINEL_LINHAS; k++)
+      if( std::strcmp(a.linhas[k], b.linhas[k]) != 0 )
+        return false;
+    return iguais(a.caixa, b.caixa);
+  }
 
+  void painel_desenha(const Painel& p) {
+    tela.cor(cores.painel);
+    tela.retangulo(p.caixa);
+    tela.cor(cores.valor);
+    for(int k = 0; k < PAINEL_LINHAS; k++)
+      tela.texto(Ponto{p.caixa.pos.x + 2, p.caixa.pos.y + 2 + k * p.alt}, p.linhas[k]);
+  }
 
+  // tempos medidos até agora
+  void mostra_tempos(std::ostream& os) {
+    tempo::histograma_mostra(os, "move", tempos.move);
+    tempo::histograma_mostra(os, "desenho", tempos.desenho);
+    tempo::histograma_mostra(os, "mostra", tempos.mostra);
+    tempo::histograma_mostra(os, "espera", tempos.espera);
+    tempo::histograma_mostra(os, "quadro", tempos.quadro);
+  }
 
-};
+  // Laço da thread de desenho: dorme até sair um retrato e desenha o mais
+  // recente. Só as regiões sujas são limpas e desenhadas de novo; o resto
+  // fica do quadro anterior.
+  void desenha_laco(void) {
+    tela.assume();
+    Retrato anterior;
+    Painel p{};
+    bool primeiro = true;
+    double ultimo = 0;   // fim do quadro anterior
+    for(;;) {
+      retratos.espera();
+      retratos.troca();
+      const Retrato& r = retratos.le();
+      if( r.fim )
+        break;
+      double t0 = tempo::agora();
+      if( primeiro )
+        tela.suja_tudo();
+      else
+        marca_sujos(r, anterior);
+      // o painel só suja a tela quando o texto muda
+      Painel novo = p;
+      if( r.painel )
+        painel_monta(novo);
+      bool muda = primeiro || r.painel != anterior.painel ||
+                  (r.painel && !painel_igual(novo, p));
+      if( !primeiro && anterior.painel && muda )
+        tela.suja(p.caixa);
+      if( r.painel && muda )
+        tela.suja(novo.caixa);
+      p = novo;
+      // cada região só refaz as figuras que a tocam
+      for(int k = 0; k < tela.sujos(); k++) {
+        tela.limpa_regiao(k);
+        desenha_figuras(r);
+        if( r.painel && tela.visivel(p.caixa) )
+          painel_desenha(p);
+      }
+      double t1 = tempo::agora();
+      tela.mostra();
+      double t2 = tempo::agora();
+      // retratos pulados também contam: captura uma vez por pedido novo
+      if( !primeiro && r.capturas != anterior.capturas ) {
+        char nome[32];
+        std::snprintf(nome, sizeof nome, "captura_%03d.ppm", r.capturas);
+        tela.captura(nome);
+      }
+      tempo::histograma_anota(tempos.desenho, t1 - t0);
+      tempo::histograma_anota(tempos.mostra, t2 - t1);
+      if( !primeiro )
+        tempo::histograma_anota(tempos.quadro, t2 - ultimo);
+      ultimo = t2;
+      primeiro = false;
+#ifdef TELA_CUSTO
+      // com -DTELA_CUSTO mostra o custo do desenho de cada quadro
+      mostra_custo(std::cerr);
+#endif
+      anterior = r;
+    }
+    tela.solta();
+  }
 
+  // passa o desenho para a thread desenhista
+  void desenho_inicia(void) {
+    retrata();
+    tela.solta();
+    desenhista = std::thread([this] { desenha_laco(); });
+  }
 
-// Protótipo da função atualiza_jogo
+  // espera a thread desenhista ver o fim do jogo e pega a tela de volta
+  void desenho_finaliza(void) {
+    retrata();
+    desenhista.join();
+    tela.assume();
+  }
 
+  // contadores da árvore desde a última chamada
+  void mostra_estatisticas(void) {
+#if ABB_ESTATISTICAS > 1
+    // com -DABB_ESTATISTICAS=2 mostra também os contadores de cada quadro
+    abb_estat_mostra(std::cerr, "quadro", estat_quadro);
+    estat_quadro = abb_estat_le();
+#endif
+  }
 
+};
 
 
 int main(int argc, char **argv) {
@@ -597,24 +1175,24 @@ int main(int argc, char **argv) {
 
    jogo.legenda();
 
-    while (!jogo.verifica_fim()) {
-    // Lógica do jogo...
-
-    // Desenha as figuras e objetos na tela
-    jogo.desenha_figuras();
-
-    // Atualiza a tela
-    jogo.atualiza();
-
-    // Espera um tempo para controlar a velocidade do jogo
-    jogo.tela.espera(30);
-
-    jogo.atualizarPontuacao(1);
-
-    
-
-    jogo.atualiza_jogo(jogo);
+  // Laço de passo fixo: o relógio da tela conta os passos devidos e o
+  // jogo os executa todos, retratando cada um. O desenho roda em outra
+  // thread, ao mesmo tempo que os passos seguintes, e a simulação nunca
+  // espera pela troca de buffers.
+  jogo.tela.relogio(Jogo::PASSOS_POR_SEGUNDO);
+  jogo.desenho_inicia();
+  while (!jogo.verifica_fim()) {
+    double t0 = tempo::agora();
+    int passos = jogo.tela.espera_passos();
+    tempo::histograma_anota(jogo.tempos.espera, tempo::agora() - t0);
+    for (int k = 0; k < passos && !jogo.verifica_fim(); k++) {
+      jogo.atualiza();
+      jogo.retrata();
+    }
+    jogo.mostra_estatisticas();
   }
+  jogo.desenho_finaliza();
+  jogo.mostra_tempos(std::cerr);
    jogo.exibirPontuacao();
 
   jogo.finaliza();
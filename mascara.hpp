@@ -0,0 +1,263 @@
+// mascara.hpp
+// Mascaras de colisao de 1 bit por pixel, para figuras com forma (sprites)
+// e escudos que vao sendo destruidos.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2023 João Vicente Ferreira Lima, UFSM
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "geom.hpp"
+
+namespace geom {
+
+// Cada linha da mascara ocupa 'palavras' palavras de 64 bits; o pixel x da
+// linha y e o bit x%64 da palavra y*palavras + x/64. Os bits depois de
+// 'larg' ficam sempre desligados. A mascara e posicionada na tela pelo
+// canto (x, y) em pixels inteiros.
+struct Mascara {
+    int larg;
+    int alt;
+    int palavras;
+    std::vector<uint64_t> bits;
+};
+
+inline void mascara_inicia(Mascara& m, int larg, int alt) {
+    m.larg = larg;
+    m.alt = alt;
+    m.palavras = (larg + 63) / 64;
+    m.bits.assign(size_t(m.palavras) * alt, 0);
+}
+
+inline uint64_t* mascara_linha(Mascara& m, int y) {
+    return &m.bits[size_t(y) * m.palavras];
+}
+
+inline const uint64_t* mascara_linha(const Mascara& m, int y) {
+    return &m.bits[size_t(y) * m.palavras];
+}
+
+inline void mascara_liga(Mascara& m, int x, int y) {
+    mascara_linha(m, y)[x / 64] |= uint64_t(1) << (x % 64);
+}
+
+inline bool mascara_bit(const Mascara& m, int x, int y) {
+    return (mascara_linha(m, y)[x / 64] >> (x % 64)) & 1;
+}
+
+// monta a mascara a partir de um desenho: uma string por linha, e os
+// caracteres diferentes de ' ' e '.' sao pixels ligados
+inline void mascara_desenho(Mascara& m, const std::vector<const char*>& linhas) {
+    int larg = 0;
+    for (const char* l : linhas)
+        larg = std::max(larg, int(std::strlen(l)));
+    mascara_inicia(m, larg, linhas.size());
+    for (int y = 0; y < m.alt; y++)
+        for (int x = 0; linhas[y][x] != '\0'; x++)
+            if (linhas[y][x] != ' ' && linhas[y][x] != '.')
+                mascara_liga(m, x, y);
+}
+
+// monta a mascara a partir de pixels RGBA (alfa no byte mais alto): liga os
+// pixels com alfa acima do limiar
+inline void mascara_pixels(Mascara& m, const uint32_t* rgba, int larg, int alt,
+                           int limiar = 127) {
+    mascara_inicia(m, larg, alt);
+    for (int y = 0; y < alt; y++)
+        for (int x = 0; x < larg; x++)
+            if (int(rgba[size_t(y) * larg + x] >> 24) > limiar)
+                mascara_liga(m, x, y);
+}
+
+// mascara do circulo de raio r (centro no pixel (r, r))
+inline void mascara_circulo(Mascara& m, int r) {
+    mascara_inicia(m, 2 * r + 1, 2 * r + 1);
+    for (int y = 0; y < m.alt; y++)
+        for (int x = 0; x < m.larg; x++)
+            if (ptemcirc(Ponto{float(x), float(y)}, Circulo{{float(r), float(r)}, float(r)}))
+                mascara_liga(m, x, y);
+}
+
+// mascara cheia de larg x alt (uma figura retangular)
+inline void mascara_cheia(Mascara& m, int larg, int alt) {
+    mascara_inicia(m, larg, alt);
+    for (int y = 0; y < alt; y++)
+        for (int x = 0; x < larg; x++)
+            mascara_liga(m, x, y);
+}
+
+// retangulo ocupado pela mascara posta em (x, y)
+constexpr Retangulo mascara_caixa(const Mascara& m, int x, int y) {
+    return Retangulo{{float(x), float(y)}, {float(m.larg), float(m.alt)}};
+}
+
+// pixels ligados
+inline int mascara_conta(const Mascara& m) {
+    int n = 0;
+    for (uint64_t w : m.bits)
+        n += std::popcount(w);
+    return n;
+}
+
+// 64 bits da linha a partir do pixel s (que pode ser negativo ou passar do
+// fim; fora da linha tudo e 0)
+inline uint64_t mascara_janela(const uint64_t* linha, int palavras, int s) {
+    int q = (s >= 0) ? s / 64 : -((63 - s) / 64);
+    int r = s - 64 * q;
+    uint64_t lo = (q >= 0 && q < palavras) ? linha[q] : 0;
+    uint64_t hi = (q + 1 >= 0 && q + 1 < palavras) ? linha[q + 1] : 0;
+    return r ? (lo >> r) | (hi << (64 - r)) : lo;
+}
+
+// Linhas de uma palavra (figuras de ate 64 pixels): testa n linhas de a
+// contra n linhas de b deslocadas de dx pixels (-64 < dx < 64), varias
+// linhas por instrucao.
+inline bool mascara_toca_linhas(const uint64_t* a, const uint64_t* b, int n, int dx) {
+    int i = 0;
+#if defined(__AVX2__)
+    const __m128i e = _mm_cvtsi32_si128(dx >= 0 ? dx : 0);
+    const __m128i d = _mm_cvtsi32_si128(dx < 0 ? -dx : 0);
+    for (; i + 4 <= n; i += 4) {
+        __m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+        vb = _mm256_srl_epi64(_mm256_sll_epi64(vb, e), d);
+        if (!_mm256_testz_si256(va, vb))
+            return true;
+    }
+#elif defined(__SSE2__)
+    const __m128i e = _mm_cvtsi32_si128(dx >= 0 ? dx : 0);
+    const __m128i d = _mm_cvtsi32_si128(dx < 0 ? -dx : 0);
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 2 <= n; i += 2) {
+        __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+        vb = _mm_srl_epi64(_mm_sll_epi64(vb, e), d);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(va, vb), zero)) != 0xffff)
+            return true;
+    }
+#endif
+    for (; i < n; i++) {
+        uint64_t w = (dx >= 0) ? b[i] << dx : b[i] >> -dx;
+        if (a[i] & w)
+            return true;
+    }
+    return false;
+}
+
+// true se algum pixel ligado de a, posta em (ax, ay), coincide com um de b,
+// posta em (bx, by). Primeiro compara as caixas (interrr); depois faz AND
+// das linhas que se sobrepoem, 64 pixels por vez.
+inline bool mascara_toca(const Mascara& a, int ax, int ay, const Mascara& b, int bx, int by) {
+    if (!interrr(mascara_caixa(a, ax, ay), mascara_caixa(b, bx, by)))
+        return false;
+    int y0 = std::max(ay, by), y1 = std::min(ay + a.alt, by + b.alt);
+    int dx = bx - ax; // pixel j de b fica sobre o pixel j+dx de a
+    if (a.palavras == 1 && b.palavras == 1)
+        return mascara_toca_linhas(mascara_linha(a, y0 - ay), mascara_linha(b, y0 - by),
+                                   y1 - y0, dx);
+
+    int k0 = std::max(0, dx) / 64;
+    int k1 = (std::min(a.larg, dx + b.larg) - 1) / 64;
+    for (int y = y0; y < y1; y++) {
+        const uint64_t* la = mascara_linha(a, y - ay);
+        const uint64_t* lb = mascara_linha(b, y - by);
+        for (int k = k0; k <= k1; k++)
+            if (la[k] & mascara_janela(lb, b.palavras, 64 * k - dx))
+                return true;
+    }
+    return false;
+}
+
+// Primeiro instante t em [0, 1] em que b, posta em (bx, by) + t * (dx, dy),
+// toca a, posta em (ax, ay), ou negativo se nao tocar. Anda um pixel por
+// vez no eixo mais longo, entao b nao atravessa uma parte fina de a.
+inline float mascara_varrida(const Mascara& a, int ax, int ay, const Mascara& b, float bx,
+                             float by, float dx, float dy) {
+    int n = std::max(1, int(std::ceil(std::max(std::abs(dx), std::abs(dy)))));
+    for (int k = 0; k <= n; k++)
+        if (mascara_toca(a, ax, ay, b, int(std::floor(bx + dx * k / n)),
+                         int(std::floor(by + dy * k / n))))
+            return float(k) / n;
+    return -1;
+}
+
+// Apaga de m (posta em (mx, my)) os pixels cobertos por f (posta em
+// (fx, fy)), como um tiro abrindo um buraco no escudo. So visita as linhas
+// em comum. Retorna quantos pixels foram apagados.
+inline int mascara_apaga(Mascara& m, int mx, int my, const Mascara& f, int fx, int fy) {
+    if (!interrr(mascara_caixa(m, mx, my), mascara_caixa(f, fx, fy)))
+        return 0;
+    int y0 = std::max(my, fy), y1 = std::min(my + m.alt, fy + f.alt);
+    int dx = fx - mx;
+    int k0 = std::max(0, dx) / 64;
+    int k1 = (std::min(m.larg, dx + f.larg) - 1) / 64;
+    int n = 0;
+    for (int y = y0; y < y1; y++) {
+        uint64_t* lm = mascara_linha(m, y - my);
+        const uint64_t* lf = mascara_linha(f, y - fy);
+        for (int k = k0; k <= k1; k++) {
+            uint64_t apaga = lm[k] & mascara_janela(lf, f.palavras, 64 * k - dx);
+            n += std::popcount(apaga);
+            lm[k] &= ~apaga;
+        }
+    }
+    return n;
+}
+
+// chama f(x0, x1, y) para cada trecho de pixels ligados [x0, x1) de cada
+// linha (para desenhar a mascara com retangulos)
+template <typename F>
+void mascara_trechos(const Mascara& m, F&& f) {
+    for (int y = 0; y < m.alt; y++) {
+        const uint64_t* l = mascara_linha(m, y);
+        int x = 0;
+        while (x < m.larg) {
+            // pula os desligados, depois anda ate o fim do trecho
+            uint64_t w = mascara_janela(l, m.palavras, x);
+            if (w == 0) {
+                x += 64;
+                continue;
+            }
+            x += std::countr_zero(w);
+            if (x >= m.larg)
+                break;
+            int x0 = x;
+            while (x < m.larg) {
+                int um = std::countr_one(mascara_janela(l, m.palavras, x));
+                x += um;
+                if (um < 64)
+                    break;
+            }
+            f(x0, std::min(x, m.larg), y);
+        }
+    }
+}
+
+}; // namespace geom
@@ -0,0 +1,224 @@
+// paralelo.hpp
+// Conjunto de threads com roubo de tarefas (work stealing) para percursos
+// fork-join sobre as arvores.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2023 João Vicente Ferreira Lima, UFSM
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace paralelo {
+
+// tarefa criada por Pool::divide; vive na pilha de quem a criou
+struct Tarefa {
+    std::function<void()> f;
+    std::atomic<bool> feita{false};
+};
+
+struct Pool;
+
+// thread atual e sua fila (threads de fora do pool usam a fila 0)
+inline thread_local Pool* pool_atual = nullptr;
+inline thread_local int fila_atual = 0;
+
+// Cada thread tem uma fila: empilha e desempilha no fim da propria fila e,
+// quando ela esta vazia, rouba do inicio da fila das outras.
+struct Pool {
+    struct Fila {
+        std::mutex m;
+        std::deque<Tarefa*> d;
+    };
+
+    std::vector<std::thread> threads;
+    std::unique_ptr<Fila[]> filas;
+    int nfilas = 0;
+    std::atomic<bool> fim{false};
+    std::atomic<int> pendentes{0}; // tarefas esperando em alguma fila
+    std::mutex m;                  // protege o sono das threads
+    std::condition_variable cv;
+
+    // cria n-1 threads de trabalho; a thread que chama divide e a n-esima.
+    // Com n <= 1 tudo roda sequencialmente.
+    void inicia(int n) {
+        if(n < 1)
+            n = 1;
+        nfilas = n;
+        filas.reset(new Fila[n]);
+        fim = false;
+        for(int i = 1; i < n; i++)
+            threads.emplace_back([this, i] { trabalha(i); });
+    }
+
+    // termina as threads de trabalho
+    void finaliza() {
+        {
+            std::lock_guard<std::mutex> lk(m);
+            fim = true;
+        }
+        cv.notify_all();
+        for(auto& t : threads)
+            t.join();
+        threads.clear();
+    }
+
+    // numero de threads que executam tarefas
+    int tamanho() const {
+        return threads.size() + 1;
+    }
+
+    // executa f e g, possivelmente em paralelo, e retorna quando ambas
+    // terminarem. Enquanto espera g, a thread executa outras tarefas.
+    template<typename F, typename G>
+    void divide(F&& f, G&& g) {
+        if(threads.empty()){
+            f();
+            g();
+            return;
+        }
+        Tarefa t;
+        t.f = std::forward<G>(g);
+        int i = (pool_atual == this) ? fila_atual : 0;
+        empilha(i, &t);
+        f();
+        while(!t.feita.load(std::memory_order_acquire)){
+            Tarefa* o = pega(i);
+            if(o != nullptr)
+                executa(o);
+            else
+                std::this_thread::yield();
+        }
+    }
+
+    void empilha(int i, Tarefa* t) {
+        {
+            std::lock_guard<std::mutex> lk(filas[i].m);
+            filas[i].d.push_back(t);
+        }
+        {
+            std::lock_guard<std::mutex> lk(m);
+            pendentes++;
+        }
+        cv.notify_one();
+    }
+
+    // pega uma tarefa da fila i ou rouba de outra fila
+    Tarefa* pega(int i) {
+        for(int k = 0; k < nfilas; k++){
+            Fila& f = filas[(i + k) % nfilas];
+            std::lock_guard<std::mutex> lk(f.m);
+            if(f.d.empty())
+                continue;
+            Tarefa* t;
+            if(k == 0){
+                t = f.d.back();
+                f.d.pop_back();
+            } else {
+                t = f.d.front();
+                f.d.pop_front();
+            }
+            pendentes--;
+            return t;
+        }
+        return nullptr;
+    }
+
+    void executa(Tarefa* t) {
+        t->f();
+        t->feita.store(true, std::memory_order_release);
+    }
+
+    void trabalha(int i) {
+        pool_atual = this;
+        fila_atual = i;
+        while(!fim){
+            Tarefa* t = pega(i);
+            if(t != nullptr){
+                executa(t);
+                continue;
+            }
+            std::unique_lock<std::mutex> lk(m);
+            cv.wait(lk, [this] { return fim || pendentes > 0; });
+        }
+    }
+};
+
+// Buffer triplo: uma thread publica valores e outra pega sempre o mais
+// recente, sem travas. Cada lado tem o seu buffer e o terceiro fica no
+// meio, trocado por um exchange atomico; o bit NOVO diz se o do meio
+// ainda nao foi lido. Quem publica nunca espera: um valor nao lido e
+// substituido pelo seguinte. O buffer devolvido por escreve() tem um valor
+// antigo e deve ser preenchido por inteiro.
+template<typename T>
+struct Triplo {
+    static constexpr unsigned NOVO = 4;
+
+    T buf[3];
+    std::atomic<unsigned> meio{1};
+    unsigned escrita = 0; // so de quem publica
+    unsigned leitura = 2; // so de quem le
+
+    // buffer a preencher antes de publica
+    T& escreve() {
+        return buf[escrita];
+    }
+
+    // torna o buffer preenchido o mais recente e pega o do meio para a
+    // proxima escrita
+    void publica() {
+        escrita = meio.exchange(escrita | NOVO, std::memory_order_acq_rel) & 3;
+        meio.notify_one();
+    }
+
+    // pega o buffer mais recente; false se nada foi publicado desde a
+    // ultima troca (le() continua com o anterior)
+    bool troca() {
+        if(!(meio.load(std::memory_order_relaxed) & NOVO))
+            return false;
+        leitura = meio.exchange(leitura, std::memory_order_acq_rel) & 3;
+        return true;
+    }
+
+    // dorme ate haver um buffer novo
+    void espera() {
+        unsigned m = meio.load(std::memory_order_relaxed);
+        while(!(m & NOVO)) {
+            meio.wait(m, std::memory_order_relaxed);
+            m = meio.load(std::memory_order_relaxed);
+        }
+    }
+
+    const T& le() const {
+        return buf[leitura];
+    }
+};
+
+}; // namespace paralelo
@@ -0,0 +1,397 @@
+// quadro.hpp
+// Desenho por software em um quadro RGBA na memoria, para rodar a tela sem
+// servidor X nem placa de video.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2023 João Vicente Ferreira Lima, UFSM
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "geom.hpp"
+#include "mascara.hpp"
+
+namespace tela {
+
+using geom::Circulo;
+using geom::Mascara;
+using geom::Ponto;
+using geom::Retangulo;
+
+// Pixels RGBA, um por uint32_t: vermelho no byte mais baixo e alfa no mais
+// alto (na memoria, em little endian, ficam R, G, B, A). Linha y comeca em
+// px[y*larg]. So os pixels dentro do corte [x0, x1) x [y0, y1) sao
+// pintados, como o retangulo de corte do allegro.
+struct Quadro {
+    int larg;
+    int alt;
+    std::vector<uint32_t> px;
+    int x0, y0, x1, y1; // corte
+};
+
+// Fonte de bitmap no formato do allegro: uma imagem com os caracteres em
+// uma grade, separados pela cor do pixel (0, 0). O primeiro caractere e o
+// espaco (32).
+struct Fonte {
+    int alt;
+    int primeiro;
+    std::vector<Mascara> glifos;
+};
+
+constexpr uint32_t quadro_rgba(int r, int g, int b, int a = 255) {
+    return uint32_t(r) | uint32_t(g) << 8 | uint32_t(b) << 16 | uint32_t(a) << 24;
+}
+
+inline void quadro_inicia(Quadro& q, int larg, int alt) {
+    q.larg = larg;
+    q.alt = alt;
+    q.px.assign(size_t(larg) * alt, quadro_rgba(0, 0, 0));
+    q.x0 = q.y0 = 0;
+    q.x1 = larg;
+    q.y1 = alt;
+}
+
+// limita os desenhos seguintes a [x0, x1) x [y0, y1), dentro do quadro
+inline void quadro_corta(Quadro& q, int x0, int y0, int x1, int y1) {
+    q.x0 = std::clamp(x0, 0, q.larg);
+    q.y0 = std::clamp(y0, 0, q.alt);
+    q.x1 = std::clamp(x1, q.x0, q.larg);
+    q.y1 = std::clamp(y1, q.y0, q.alt);
+}
+
+inline void quadro_descorta(Quadro& q) {
+    quadro_corta(q, 0, 0, q.larg, q.alt);
+}
+
+// true se a caixa [x0, x1) x [y0, y1) nao toca o corte
+inline bool quadro_fora(const Quadro& q, float x0, float y0, float x1, float y1) {
+    return x1 < q.x0 || x0 >= q.x1 || y1 < q.y0 || y0 >= q.y1;
+}
+
+// pinta o corte inteiro
+inline void quadro_limpa(Quadro& q, uint32_t cor) {
+    if (q.x0 == 0 && q.y0 == 0 && q.x1 == q.larg && q.y1 == q.alt) {
+        std::fill(q.px.begin(), q.px.end(), cor);
+        return;
+    }
+    for (int y = q.y0; y < q.y1; y++)
+        std::fill_n(&q.px[size_t(y) * q.larg + q.x0], q.x1 - q.x0, cor);
+}
+
+inline uint32_t quadro_pixel(const Quadro& q, int x, int y) {
+    return q.px[size_t(y) * q.larg + x];
+}
+
+// pinta os pixels [x0, x1) da linha y, cortando o que sair do corte
+inline void quadro_trecho(Quadro& q, int y, int x0, int x1, uint32_t cor) {
+    if (y < q.y0 || y >= q.y1)
+        return;
+    x0 = std::max(x0, q.x0);
+    x1 = std::min(x1, q.x1);
+    if (x0 < x1)
+        std::fill_n(&q.px[size_t(y) * q.larg + x0], x1 - x0, cor);
+}
+
+// primeiro pixel cujo centro fica em v ou depois
+inline int quadro_centro(float v) {
+    return (int)std::ceil(v - 0.5f);
+}
+
+// Um pixel e pintado quando seu centro esta dentro da figura, como no
+// allegro: o retangulo [x0, x1) x [y0, y1) pinta os centros nesse intervalo.
+inline void quadro_retangulo(Quadro& q, Retangulo r, uint32_t cor) {
+    int x0 = quadro_centro(r.pos.x), x1 = quadro_centro(r.pos.x + r.tam.larg);
+    int y0 = std::max(quadro_centro(r.pos.y), q.y0);
+    int y1 = std::min(quadro_centro(r.pos.y + r.tam.alt), q.y1);
+    for (int y = y0; y < y1; y++)
+        quadro_trecho(q, y, x0, x1, cor);
+}
+
+// um trecho por linha: a meia corda do circulo na altura do centro do pixel
+inline void quadro_circulo(Quadro& q, Circulo c, uint32_t cor) {
+    float r2 = c.raio * c.raio;
+    int y0 = std::max(quadro_centro(c.centro.y - c.raio), q.y0);
+    int y1 = std::min(quadro_centro(c.centro.y + c.raio), q.y1);
+    for (int y = y0; y < y1; y++) {
+        float dy = y + 0.5f - c.centro.y;
+        float meia = std::sqrt(std::max(r2 - dy * dy, 0.0f));
+        quadro_trecho(q, y, quadro_centro(c.centro.x - meia), quadro_centro(c.centro.x + meia),
+                      cor);
+    }
+}
+
+// linha de um pixel de largura: um pixel por passo no eixo mais comprido
+inline void quadro_linha(Quadro& q, Ponto a, Ponto b, uint32_t cor) {
+    if (quadro_fora(q, std::min(a.x, b.x), std::min(a.y, b.y), std::max(a.x, b.x),
+                    std::max(a.y, b.y)))
+        return;
+    float dx = b.x - a.x, dy = b.y - a.y;
+    int n = (int)std::ceil(std::max(std::fabs(dx), std::fabs(dy)));
+    if (n == 0)
+        n = 1;
+    for (int k = 0; k <= n; k++) {
+        int x = (int)std::floor(a.x + dx * k / n), y = (int)std::floor(a.y + dy * k / n);
+        if (x >= q.x0 && x < q.x1 && y >= q.y0 && y < q.y1)
+            q.px[size_t(y) * q.larg + x] = cor;
+    }
+}
+
+// le uma imagem TGA sem compressao (tipo 2) ou com RLE (tipo 10), de 24 ou
+// 32 bits, para pixels RGBA de cima para baixo
+inline bool quadro_le_tga(const char* nome, Quadro& q) {
+    FILE* f = std::fopen(nome, "rb");
+    if (f == nullptr)
+        return false;
+    std::vector<uint8_t> d;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof buf, f)) > 0)
+        d.insert(d.end(), buf, buf + n);
+    std::fclose(f);
+    if (d.size() < 18 || d[1] != 0 || (d[2] != 2 && d[2] != 10) || (d[16] != 24 && d[16] != 32))
+        return false;
+    int larg = d[12] | d[13] << 8, alt = d[14] | d[15] << 8, bytes = d[16] / 8;
+    bool de_cima = d[17] & 0x20;
+    quadro_inicia(q, larg, alt);
+
+    size_t i = 18 + d[0], total = size_t(larg) * alt, k = 0;
+    auto le = [&](uint32_t& p) {
+        if (i + bytes > d.size())
+            return false;
+        // TGA guarda B, G, R (, A)
+        p = quadro_rgba(d[i + 2], d[i + 1], d[i], bytes == 4 ? d[i + 3] : 255);
+        i += bytes;
+        return true;
+    };
+    auto poe = [&](uint32_t p) {
+        int x = k % larg, y = k / larg;
+        q.px[size_t(de_cima ? y : alt - 1 - y) * larg + x] = p;
+        k++;
+    };
+    while (k < total) {
+        uint32_t p;
+        if (d[2] == 2) {
+            if (!le(p))
+                return false;
+            poe(p);
+            continue;
+        }
+        if (i >= d.size())
+            return false;
+        int c = d[i++], rep = (c & 0x7f) + 1;
+        if (c & 0x80) {
+            if (!le(p))
+                return false;
+            for (int r = 0; r < rep && k < total; r++)
+                poe(p);
+        } else {
+            for (int r = 0; r < rep && k < total; r++) {
+                if (!le(p))
+                    return false;
+                poe(p);
+            }
+        }
+    }
+    return true;
+}
+
+// grava o quadro inteiro como PPM binario (P6), sem o alfa
+inline bool quadro_grava_ppm(const Quadro& q, const char* nome) {
+    FILE* f = std::fopen(nome, "wb");
+    if (f == nullptr)
+        return false;
+    std::fprintf(f, "P6\n%d %d\n255\n", q.larg, q.alt);
+    std::vector<uint8_t> linha(size_t(q.larg) * 3);
+    bool ok = true;
+    for (int y = 0; y < q.alt && ok; y++) {
+        for (int x = 0; x < q.larg; x++) {
+            uint32_t p = quadro_pixel(q, x, y);
+            linha[3 * x] = p & 0xff;
+            linha[3 * x + 1] = (p >> 8) & 0xff;
+            linha[3 * x + 2] = (p >> 16) & 0xff;
+        }
+        ok = std::fwrite(linha.data(), 1, linha.size(), f) == linha.size();
+    }
+    return std::fclose(f) == 0 && ok;
+}
+
+// maior largura ou altura aceita por quadro_le_ppm
+constexpr int QUADRO_PPM_MAX = 1 << 15;
+
+// le um PPM binario (P6) de 8 bits por canal, com alfa 255. Recusa lados
+// zero ou maiores que QUADRO_PPM_MAX e valor maximo diferente de 255.
+inline bool quadro_le_ppm(const char* nome, Quadro& q) {
+    FILE* f = std::fopen(nome, "rb");
+    if (f == nullptr)
+        return false;
+    // cabecalho: P6, largura, altura e valor maximo, com comentarios (#)
+    int v[3], c = 0;
+    bool ok = std::fgetc(f) == 'P' && std::fgetc(f) == '6';
+    for (int k = 0; k < 3 && ok; k++) {
+        c = std::fgetc(f);
+        while (c == '#' || c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            if (c == '#')
+                while (c != '\n' && c != EOF)
+                    c = std::fgetc(f);
+            c = std::fgetc(f);
+        }
+        v[k] = 0;
+        ok = c >= '0' && c <= '9';
+        // para de somar passando do limite, antes de estourar o int
+        for (; c >= '0' && c <= '9' && ok; c = std::fgetc(f)) {
+            v[k] = 10 * v[k] + (c - '0');
+            ok = v[k] <= QUADRO_PPM_MAX;
+        }
+    }
+    ok = ok && v[0] > 0 && v[1] > 0 && v[2] == 255;
+    // depois do valor maximo vem um so espaco e os pixels
+    if (!ok || (c != ' ' && c != '\t' && c != '\r' && c != '\n')) {
+        std::fclose(f);
+        return false;
+    }
+    quadro_inicia(q, v[0], v[1]);
+    std::vector<uint8_t> linha(size_t(q.larg) * 3);
+    for (int y = 0; y < q.alt && ok; y++) {
+        ok = std::fread(linha.data(), 1, linha.size(), f) == linha.size();
+        for (int x = 0; x < q.larg && ok; x++)
+            q.px[size_t(y) * q.larg + x] =
+                quadro_rgba(linha[3 * x], linha[3 * x + 1], linha[3 * x + 2]);
+    }
+    std::fclose(f);
+    return ok;
+}
+
+// maior diferenca entre os canais R, G e B de dois pixels
+inline int quadro_difere(uint32_t a, uint32_t b) {
+    if (((a ^ b) & 0xffffff) == 0)
+        return 0;
+    int m = 0;
+    for (int c = 0; c < 24; c += 8)
+        m = std::max(m, std::abs(int((a >> c) & 0xff) - int((b >> c) & 0xff)));
+    return m;
+}
+
+// resultado de quadro_compara
+struct QuadroDiferenca {
+    int pixels; // pixels diferentes alem da tolerancia (-1: tamanhos diferentes)
+    int maior;  // maior diferenca em um canal
+};
+
+// Compara a cor de cada pixel de a e b. Um pixel conta como diferente
+// quando algum canal difere mais que 'tolerancia'.
+inline QuadroDiferenca quadro_compara(const Quadro& a, const Quadro& b, int tolerancia = 0) {
+    QuadroDiferenca d{0, 0};
+    if (a.larg != b.larg || a.alt != b.alt)
+        return QuadroDiferenca{-1, 255};
+    for (size_t k = 0; k < a.px.size(); k++) {
+        int m = quadro_difere(a.px[k], b.px[k]);
+        d.maior = std::max(d.maior, m);
+        d.pixels += m > tolerancia;
+    }
+    return d;
+}
+
+// Carrega a fonte de um TGA como o al_load_font do allegro: cada faixa de
+// linhas entre linhas da cor separadora tem glifos lado a lado, cada um
+// ate a proxima coluna separadora. Os pixels opacos sao a tinta.
+inline bool quadro_fonte(Fonte& fonte, const char* nome) {
+    Quadro img;
+    if (!quadro_le_tga(nome, img) || img.larg == 0 || img.alt == 0)
+        return false;
+    uint32_t sep = quadro_pixel(img, 0, 0);
+    fonte.alt = 0;
+    fonte.primeiro = ' ';
+    fonte.glifos.clear();
+    int y = 0;
+    while (y < img.alt) {
+        // procura a proxima faixa de glifos
+        int x = 0;
+        while (x < img.larg && quadro_pixel(img, x, y) == sep)
+            x++;
+        if (x == img.larg) {
+            y++;
+            continue;
+        }
+        int alt = 0;
+        while (y + alt < img.alt && quadro_pixel(img, x, y + alt) != sep)
+            alt++;
+        fonte.alt = std::max(fonte.alt, alt);
+        while (x < img.larg) {
+            if (quadro_pixel(img, x, y) == sep) {
+                x++;
+                continue;
+            }
+            int larg = 0;
+            while (x + larg < img.larg && quadro_pixel(img, x + larg, y) != sep)
+                larg++;
+            Mascara g;
+            geom::mascara_inicia(g, larg, alt);
+            for (int v = 0; v < alt; v++)
+                for (int u = 0; u < larg; u++)
+                    if ((quadro_pixel(img, x + u, y + v) >> 24) > 127)
+                        geom::mascara_liga(g, u, v);
+            fonte.glifos.push_back(std::move(g));
+            x += larg;
+        }
+        y += alt;
+    }
+    return !fonte.glifos.empty();
+}
+
+// glifo do caractere c (o espaco se a fonte nao tiver c)
+inline const Mascara& quadro_glifo(const Fonte& fonte, char c) {
+    int k = (unsigned char)c - fonte.primeiro;
+    if (k < 0 || k >= (int)fonte.glifos.size())
+        k = 0;
+    return fonte.glifos[k];
+}
+
+// pixels horizontais do texto s
+inline int quadro_largura_texto(const Fonte& fonte, const char* s) {
+    int larg = 0;
+    for (; *s != '\0'; s++)
+        larg += quadro_glifo(fonte, *s).larg;
+    return larg;
+}
+
+// escreve s com o canto superior esquerdo em p
+inline void quadro_texto(Quadro& q, const Fonte& fonte, Ponto p, const char* s, uint32_t cor) {
+    int x = (int)std::floor(p.x), y = (int)std::floor(p.y);
+    if (y >= q.y1 || y + fonte.alt <= q.y0)
+        return;
+    for (; *s != '\0' && x < q.x1; s++) {
+        const Mascara& g = quadro_glifo(fonte, *s);
+        geom::mascara_trechos(g, [&](int x0, int x1, int v) {
+            quadro_trecho(q, y + v, x + x0, x + x1, cor);
+        });
+        x += g.larg;
+    }
+}
+
+}; // namespace tela
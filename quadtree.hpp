@@ -0,0 +1,254 @@
+// quadtree.hpp
+// Quadtree folgada (loose quadtree) para objetos que se movem pelo campo de
+// jogo: tiros, laser e invaders, com consultas por area e por ponto.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2023 João Vicente Ferreira Lima, UFSM
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <vector>
+
+#include "geom.hpp"
+
+namespace geom {
+
+// niveis maximos (a raiz e o nivel 0)
+const int QUADTREE_NIVEIS = 10;
+
+// O nivel l divide o mundo em 2^l x 2^l celulas. Cada objeto fica no nivel
+// mais fundo cuja celula e pelo menos do seu tamanho, na celula que contem
+// seu centro. A caixa folgada de um no e a celula aumentada de meia celula
+// de cada lado, e contem todos os objetos do no; assim um objeto fica em um
+// so no e andar um pouco raramente o tira de la. Objetos com centro fora do
+// mundo ficam na raiz, que e sempre visitada.
+//
+// Nos e itens ficam em vetores com listas de livres, entao inserir e remover
+// nao alocam memoria depois que os vetores cresceram.
+struct Quadtree {
+    struct No {
+        int filhos[4]; // -1 se nao existe
+        int primeiro;  // primeiro item do no (lista ligada)
+        int total;     // itens no no e abaixo dele
+        int pai;
+        int nivel, cx, cy;
+    };
+
+    struct Item {
+        Retangulo r;
+        int no;        // -1 se o id esta livre
+        int ant, prox; // lista do no
+    };
+
+    Retangulo mundo;
+    int niveis;
+    std::vector<No> nos;
+    std::vector<int> nos_livres;
+    std::vector<Item> itens;
+    std::vector<int> itens_livres;
+};
+
+// cria um no vazio e retorna seu indice
+inline int quadtree_novo_no(Quadtree& q, int pai, int nivel, int cx, int cy) {
+    Quadtree::No no{{-1, -1, -1, -1}, -1, 0, pai, nivel, cx, cy};
+    if (!q.nos_livres.empty()) {
+        int i = q.nos_livres.back();
+        q.nos_livres.pop_back();
+        q.nos[i] = no;
+        return i;
+    }
+    q.nos.push_back(no);
+    return q.nos.size() - 1;
+}
+
+// mundo e a regiao coberta (o campo de jogo); niveis <= QUADTREE_NIVEIS
+inline void quadtree_inicia(Quadtree& q, Retangulo mundo, int niveis = QUADTREE_NIVEIS) {
+    q.mundo = mundo;
+    q.niveis = (niveis < 1) ? 1 : (niveis > QUADTREE_NIVEIS ? QUADTREE_NIVEIS : niveis);
+    q.nos.clear();
+    q.nos_livres.clear();
+    q.itens.clear();
+    q.itens_livres.clear();
+    quadtree_novo_no(q, -1, 0, 0, 0);
+}
+
+// caixa folgada do no i
+inline Retangulo quadtree_caixa(const Quadtree& q, int i) {
+    const Quadtree::No& no = q.nos[i];
+    float n = float(1 << no.nivel);
+    float w = q.mundo.tam.larg / n, h = q.mundo.tam.alt / n;
+    return Retangulo{{q.mundo.pos.x + (no.cx - 0.5f) * w, q.mundo.pos.y + (no.cy - 0.5f) * h},
+                     {2 * w, 2 * h}};
+}
+
+// nivel e celula onde r deve ficar
+inline void quadtree_lugar(const Quadtree& q, Retangulo r, int& nivel, int& cx, int& cy) {
+    float u = (r.pos.x + r.tam.larg / 2 - q.mundo.pos.x) / q.mundo.tam.larg;
+    float v = (r.pos.y + r.tam.alt / 2 - q.mundo.pos.y) / q.mundo.tam.alt;
+    nivel = cx = cy = 0;
+    if (!(u >= 0 && u < 1 && v >= 0 && v < 1))
+        return;
+    float s = r.tam.larg / q.mundo.tam.larg;
+    if (r.tam.alt / q.mundo.tam.alt > s)
+        s = r.tam.alt / q.mundo.tam.alt;
+    float celula = 1;
+    while (nivel + 1 < q.niveis && celula / 2 >= s) {
+        celula /= 2;
+        nivel++;
+    }
+    int n = 1 << nivel;
+    cx = int(u * n);
+    cy = int(v * n);
+    if (cx >= n)
+        cx = n - 1;
+    if (cy >= n)
+        cy = n - 1;
+}
+
+// coloca o item id no no (nivel, cx, cy), criando o caminho se preciso
+inline void quadtree_liga(Quadtree& q, int id, int nivel, int cx, int cy) {
+    int i = 0;
+    q.nos[0].total++;
+    for (int l = 1; l <= nivel; l++) {
+        int sx = (cx >> (nivel - l)) & 1, sy = (cy >> (nivel - l)) & 1;
+        int f = q.nos[i].filhos[sx + 2 * sy];
+        if (f < 0) {
+            const Quadtree::No& pai = q.nos[i];
+            f = quadtree_novo_no(q, i, l, 2 * pai.cx + sx, 2 * pai.cy + sy);
+            q.nos[i].filhos[sx + 2 * sy] = f;
+        }
+        i = f;
+        q.nos[i].total++;
+    }
+    Quadtree::Item& it = q.itens[id];
+    it.no = i;
+    it.ant = -1;
+    it.prox = q.nos[i].primeiro;
+    if (it.prox >= 0)
+        q.itens[it.prox].ant = id;
+    q.nos[i].primeiro = id;
+}
+
+// tira o item id do seu no, liberando os nos que ficarem vazios
+inline void quadtree_desliga(Quadtree& q, int id) {
+    Quadtree::Item& it = q.itens[id];
+    int i = it.no;
+    if (it.ant >= 0)
+        q.itens[it.ant].prox = it.prox;
+    else
+        q.nos[i].primeiro = it.prox;
+    if (it.prox >= 0)
+        q.itens[it.prox].ant = it.ant;
+    it.no = -1;
+
+    while (i >= 0) {
+        Quadtree::No& no = q.nos[i];
+        int pai = no.pai;
+        if (--no.total == 0 && pai >= 0) {
+            for (int& f : q.nos[pai].filhos)
+                if (f == i)
+                    f = -1;
+            q.nos_livres.push_back(i);
+        }
+        i = pai;
+    }
+}
+
+// insere o retangulo r e retorna seu id
+inline int quadtree_insere(Quadtree& q, Retangulo r) {
+    int id;
+    if (!q.itens_livres.empty()) {
+        id = q.itens_livres.back();
+        q.itens_livres.pop_back();
+    } else {
+        id = q.itens.size();
+        q.itens.push_back({});
+    }
+    q.itens[id].r = r;
+    int nivel, cx, cy;
+    quadtree_lugar(q, r, nivel, cx, cy);
+    quadtree_liga(q, id, nivel, cx, cy);
+    return id;
+}
+
+inline void quadtree_remove(Quadtree& q, int id) {
+    quadtree_desliga(q, id);
+    q.itens_livres.push_back(id);
+}
+
+// muda o retangulo do item id; so troca de no se sair da celula
+inline void quadtree_move(Quadtree& q, int id, Retangulo r) {
+    Quadtree::Item& it = q.itens[id];
+    it.r = r;
+    int nivel, cx, cy;
+    quadtree_lugar(q, r, nivel, cx, cy);
+    const Quadtree::No& no = q.nos[it.no];
+    if (no.nivel == nivel && no.cx == cx && no.cy == cy)
+        return;
+    quadtree_desliga(q, id);
+    quadtree_liga(q, id, nivel, cx, cy);
+}
+
+// visita os nos cuja caixa folgada passa em 'entra' (a raiz sempre) e chama
+// f(id) para cada item desses nos
+template <typename E, typename F>
+void quadtree_percorre(const Quadtree& q, E&& entra, F&& f) {
+    int pilha[4 * QUADTREE_NIVEIS];
+    int topo = 0;
+    pilha[topo++] = 0;
+    while (topo > 0) {
+        int i = pilha[--topo];
+        if (i != 0 && !entra(quadtree_caixa(q, i)))
+            continue;
+        const Quadtree::No& no = q.nos[i];
+        for (int id = no.primeiro; id >= 0; id = q.itens[id].prox)
+            f(id);
+        for (int k = 0; k < 4; k++)
+            if (no.filhos[k] >= 0)
+                pilha[topo++] = no.filhos[k];
+    }
+}
+
+// coloca em 'saida' os ids dos retangulos que tocam 'area'
+inline void quadtree_consulta(const Quadtree& q, Retangulo area, std::vector<int>& saida) {
+    saida.clear();
+    quadtree_percorre(
+        q, [area](const Retangulo& c) { return interrr(area, c); },
+        [&](int id) {
+            if (interrr(area, q.itens[id].r))
+                saida.push_back(id);
+        });
+}
+
+// coloca em 'saida' os ids dos retangulos que contem o ponto p
+inline void quadtree_ponto(const Quadtree& q, Ponto p, std::vector<int>& saida) {
+    saida.clear();
+    quadtree_percorre(
+        q, [p](const Retangulo& c) { return ptemret(p, c); },
+        [&](int id) {
+            if (ptemret(p, q.itens[id].r))
+                saida.push_back(id);
+        });
+}
+
+}; // namespace geom
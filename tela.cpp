@@ -25,7 +25,11 @@
 // SOFTWARE.
 
 #include <iostream>
+#include <cstdio>
 #include <cstdlib>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 
 #include "tela.hpp"
 #include "geom.hpp"
@@ -75,7 +79,20 @@ void Tela::inicia(int larg, int alt, const char *nome) {
     _rato.x = 0;
     _rato.y = 0;
     _botao = false;
-    _tecla = 0;
+    _teclas.reset();
+    _ev_inicio = _ev_fim = 0;
+    _ev_perdidos = 0;
+    _lote.reserve(6 * 1024);
+    _segura = false;
+    _ultima = Cor{-1, -1, -1};
+    _custo = _custo_quadro = TelaCusto{};
+    _inicio_quadro = 0;
+    _alvo = NULL;
+    _sujos.clear();
+    _mostrados.clear();
+    _regiao = -1;
+    _gravando = false;
+    _fim_capturas = false;
 
     /* inicializa o allegro */
     if (!al_init()) {
@@ -83,11 +100,16 @@ void Tela::inicia(int larg, int alt, const char *nome) {
         std::abort();
     }
 
-    /* conecta com tela X */
-    display = al_create_display(larg, alt);
-    if (display == NULL) {
-        std::cerr << "falha ao criar display do allegro" << std::endl;
-        std::abort();
+    /* conecta com tela X; sem ela, desenha na memoria */
+    display = NULL;
+    sem_janela = std::getenv("TELA_SEM_JANELA") != NULL;
+    if (!sem_janela) {
+        display = al_create_display(larg, alt);
+        if (display == NULL) {
+            std::cerr << "falha ao criar display do allegro; desenhando na "
+                         "memoria" << std::endl;
+            sem_janela = true;
+        }
     }
 
     janela.pos.x = 0;
@@ -97,30 +119,55 @@ void Tela::inicia(int larg, int alt, const char *nome) {
     janela.tam.larg = XX2U(tam.larg);
     janela.tam.alt = YX2U(tam.alt);
 
-    /* Titulo da tela */
-    al_set_window_title(display, nome);
-
     /* cria contextos grafico */
     ac_fundo = al_map_rgb(255, 255, 255);
     ac_cor = al_map_rgb(0, 0, 0);
-
-    /* instala o driver de mouse e teclado */
-    al_install_mouse();
-    al_install_keyboard();
-    al_init_primitives_addon();
-
-    /* configura fonte */
-    al_init_font_addon();
-    al_init_image_addon();
-    // fonte = al_load_bitmap_font("data/a4_font.tga");
-    fonte = al_load_font("data/fixed_font.tga", 0, 0);
-    if (!fonte) {
-        std::cerr << "falha ao carregar fonte do allegro" << std::endl;
-        std::abort();
+    _rgba_fundo = quadro_rgba(255, 255, 255);
+    _rgba = quadro_rgba(0, 0, 0);
+
+    if (sem_janela) {
+        /* quadro e fonte em memoria, sem nada do allegro */
+        quadro_inicia(quadro, larg, alt);
+        fonte = NULL;
+        _digitos = NULL;
+        if (!quadro_fonte(_fonte_quadro, "data/fixed_font.tga")) {
+            std::cerr << "falha ao carregar fonte" << std::endl;
+            std::abort();
+        }
+    } else {
+        /* Titulo da tela */
+        al_set_window_title(display, nome);
+
+        /* instala o driver de mouse e teclado */
+        al_install_mouse();
+        al_install_keyboard();
+        al_init_primitives_addon();
+
+        /* configura fonte */
+        al_init_font_addon();
+        al_init_image_addon();
+        // fonte = al_load_bitmap_font("data/a4_font.tga");
+        fonte = al_load_font("data/fixed_font.tga", 0, 0);
+        if (!fonte) {
+            std::cerr << "falha ao carregar fonte do allegro" << std::endl;
+            std::abort();
+        }
+        inicia_digitos();
+
+        /* desenha fora da janela, para o quadro anterior nao se perder na
+         * troca de buffers; so as regioes sujas sao refeitas */
+        _alvo = al_create_bitmap(larg, alt);
+        if (_alvo == NULL) {
+            std::cerr << "falha ao criar bitmap da tela" << std::endl;
+            std::abort();
+        }
+        al_set_target_bitmap(_alvo);
+        al_clear_to_color(ac_fundo);
     }
 
-    /* inicia o timer */
-    /* timer = al_create_timer(1.000 / FPS); */
+    /* o timer so e criado por relogio() */
+    timer = NULL;
+    _passos = 0;
 
     /* fila para eventos */
     queue = al_create_event_queue();
@@ -130,135 +177,510 @@ void Tela::inicia(int larg, int alt, const char *nome) {
     }
 
     /* registra para receber eventos de tela/teclado/mouse */
-    al_register_event_source(queue, al_get_keyboard_event_source());
-    al_register_event_source(queue, al_get_display_event_source(display));
-    al_register_event_source(queue, al_get_mouse_event_source());
-    // al_register_event_source(queue,
-    // al_get_timer_event_source(timer));
+    if (!sem_janela) {
+        al_register_event_source(queue, al_get_keyboard_event_source());
+        al_register_event_source(queue, al_get_display_event_source(display));
+        al_register_event_source(queue, al_get_mouse_event_source());
+    }
+}
+
+/* desenha os caracteres de um numero, lado a lado, em um bitmap; numero
+ * copia pedacos dele em vez de formatar e desenhar texto */
+void Tela::inicia_digitos() {
+    const char *cs = "-0123456789";
+    int larg = 0;
+    for (int k = 0; k < 11; k++) {
+        char c[2] = {cs[k], '\0'};
+        _digito_x[k] = larg;
+        _digito_larg[k] = al_get_text_width(fonte, c);
+        larg += _digito_larg[k];
+    }
+    _digitos = al_create_bitmap(larg, al_get_font_line_height(fonte));
+    if (_digitos == NULL) {
+        std::cerr << "falha ao criar bitmap dos digitos" << std::endl;
+        std::abort();
+    }
+    al_set_target_bitmap(_digitos);
+    al_clear_to_color(al_map_rgba(0, 0, 0, 0));
+    for (int k = 0; k < 11; k++) {
+        char c[2] = {cs[k], '\0'};
+        al_draw_text(fonte, al_map_rgb(255, 255, 255), _digito_x[k], 0,
+                     ALLEGRO_ALIGN_LEFT, c);
+    }
+    al_set_target_backbuffer(display);
 }
 
 void Tela::limpa() {
+    /* o que estava no lote seria apagado de qualquer jeito */
+    _lote.clear();
+    if (_segura) {
+        al_hold_bitmap_drawing(false);
+        _segura = false;
+    }
     /* preenche um retangulo do tamanho da tela com a cor de fundo */
-    al_clear_to_color(ac_fundo);
+    if (sem_janela) {
+        quadro_descorta(quadro);
+        quadro_limpa(quadro, _rgba_fundo);
+    } else {
+        al_reset_clipping_rectangle();
+        al_clear_to_color(ac_fundo);
+    }
+    /* a tela toda muda */
+    suja_tudo();
+    _regiao = -1;
+    _inicio_quadro = al_get_time();
 }
 
 void Tela::mostra() {
-    /* Troca os buffers de video, passando o que foi desenhado para tela */
+    descarrega();
+    _custo.ms = (al_get_time() - _inicio_quadro) * 1e3;
+    _custo_quadro = _custo;
+    _custo = TelaCusto{};
+    _regiao = -1;
+    if (sem_janela) {
+        _sujos.clear();
+        quadro_descorta(quadro);
+        return;
+    }
+    /* copia para o buffer de tras so as regioes sujas e troca os buffers
+     * de video. Com dois buffers, o de tras ainda tem o quadro de dois
+     * antes: faltam as regioes deste quadro e as do anterior. Depois volta
+     * a desenhar no quadro */
+    al_reset_clipping_rectangle();
+    al_set_target_backbuffer(display);
+    for (const std::vector<Retangulo> *v : {&_sujos, &_mostrados})
+        for (const Retangulo &r : *v)
+            al_draw_bitmap_region(_alvo, r.pos.x, r.pos.y, r.tam.larg, r.tam.alt,
+                                  r.pos.x, r.pos.y, 0);
     al_flip_display();
+    al_set_target_bitmap(_alvo);
+    _mostrados.swap(_sujos);
+    _sujos.clear();
+}
+
+void Tela::suja(Retangulo r) {
+    /* arredonda para fora, com um pixel de folga para a borda das figuras,
+     * e corta na tela */
+    float x0 = std::max(std::floor(r.pos.x) - 1, 0.0f);
+    float y0 = std::max(std::floor(r.pos.y) - 1, 0.0f);
+    float x1 = std::min(std::ceil(r.pos.x + r.tam.larg) + 1, tam.larg);
+    float y1 = std::min(std::ceil(r.pos.y + r.tam.alt) + 1, tam.alt);
+    if (x0 >= x1 || y0 >= y1)
+        return;
+    Retangulo n{{x0, y0}, {x1 - x0, y1 - y0}};
+    /* junta com as regioes que tocar; a uniao pode tocar outras */
+    for (size_t k = 0; k < _sujos.size();) {
+        if (interrr(n, _sujos[k])) {
+            n = uniao(n, _sujos[k]);
+            _sujos.erase(_sujos.begin() + k);
+            k = 0;
+        } else
+            k++;
+    }
+    if (_sujos.size() < (size_t)TELA_SUJOS) {
+        _sujos.push_back(n);
+        return;
+    }
+    /* lista cheia: junta com a regiao que menos cresce */
+    size_t melhor = 0;
+    float menor = 0;
+    for (size_t k = 0; k < _sujos.size(); k++) {
+        Retangulo u = uniao(n, _sujos[k]);
+        float cresce = u.tam.larg * u.tam.alt - _sujos[k].tam.larg * _sujos[k].tam.alt;
+        if (k == 0 || cresce < menor) {
+            melhor = k;
+            menor = cresce;
+        }
+    }
+    n = uniao(n, _sujos[melhor]);
+    _sujos.erase(_sujos.begin() + melhor);
+    suja(n);
+}
+
+void Tela::suja_tudo() {
+    _sujos.assign(1, Retangulo{{0, 0}, tam});
 }
 
-/* tempo de espera em microsegundos */
-void Tela::espera(double ms) {
-    al_rest(ms / 1e3);
+int Tela::sujos() const {
+    return _sujos.size();
+}
+
+void Tela::limpa_regiao(int i) {
+    /* o que ja foi pedido e da regiao anterior */
+    descarrega();
+    if (i == 0)
+        _inicio_quadro = al_get_time();
+    _regiao = i;
+    const Retangulo &r = _sujos[i];
+    int x = r.pos.x, y = r.pos.y, larg = r.tam.larg, alt = r.tam.alt;
+    if (sem_janela) {
+        quadro_corta(quadro, x, y, x + larg, y + alt);
+        quadro_limpa(quadro, _rgba_fundo);
+    } else {
+        al_set_clipping_rectangle(x, y, larg, alt);
+        al_clear_to_color(ac_fundo);
+    }
+}
+
+bool Tela::visivel(Retangulo r) const {
+    /* um pixel de folga, como em suja, para linhas finas e bordas */
+    Retangulo f{{r.pos.x - 1, r.pos.y - 1}, {r.tam.larg + 2, r.tam.alt + 2}};
+    return _regiao < 0 || interrr(f, _sujos[_regiao]);
+}
+
+void Tela::descarrega() {
+    /* primeiro os numeros, que foram pedidos antes dos triangulos */
+    if (_segura) {
+        al_hold_bitmap_drawing(false);
+        _segura = false;
+        _custo.chamadas++;
+    }
+    /* desenha todos os triangulos acumulados de uma vez */
+    if (_lote.empty())
+        return;
+    _custo.chamadas++;
+    _custo.vertices += _lote.size();
+    al_draw_prim(_lote.data(), NULL, NULL, 0, _lote.size(),
+                 ALLEGRO_PRIM_TRIANGLE_LIST);
+    _lote.clear();
+}
+
+void Tela::assume() {
+    if (!sem_janela)
+        al_set_target_bitmap(_alvo);
+}
+
+void Tela::solta() {
+    if (!sem_janela)
+        al_set_target_bitmap(NULL);
 }
 
 void Tela::finaliza() {
     /* o programa vai morrer, o fim da conexao com o servidor X fecha tudo */
-    al_destroy_display(display);
+    if (timer != NULL)
+        al_destroy_timer(timer);
+    /* as capturas pedidas ainda sao gravadas */
+    if (_gravador.joinable()) {
+        {
+            std::lock_guard<std::mutex> lk(_capturas_m);
+            _fim_capturas = true;
+        }
+        _capturas_cv.notify_all();
+        _gravador.join();
+    }
+    if (!sem_janela) {
+        al_destroy_bitmap(_alvo);
+        al_destroy_bitmap(_digitos);
+        al_destroy_display(display);
+    }
     al_destroy_event_queue(queue);
 }
 
 int Tela::tecla() {
-    /* retorna a ultima _tecla pressionada */
-    int tecla;
+    /* retorna a proxima tecla pressionada da fila */
+    EventoTecla e;
+    while (proximo_evento(e))
+        if (e.desce)
+            return e.tecla;
+    return 0;
+}
+
+bool Tela::proximo_evento(EventoTecla &e) {
     processa_eventos();
-    tecla = _tecla;
-    _tecla = 0;
-    return tecla;
+    if (_ev_inicio == _ev_fim)
+        return false;
+    e = _eventos[_ev_inicio++ % TELA_EVENTOS];
+    return true;
+}
+
+bool Tela::apertada(int tecla) const {
+    return tecla >= 0 && tecla < ALLEGRO_KEY_MAX && _teclas[tecla];
+}
+
+/* poe um evento de teclado na fila, descartando o mais antigo se encher */
+static void enfileira(EventoTecla *eventos, unsigned &inicio, unsigned &fim,
+                      long &perdidos, EventoTecla e) {
+    if (fim - inicio == (unsigned)TELA_EVENTOS) {
+        inicio++;
+        perdidos++;
+    }
+    eventos[fim++ % TELA_EVENTOS] = e;
 }
 
 void Tela::processa_eventos() {
-    /* processa eventos do servidor X, atualizando a posicao do mouse
-     * e ultima _tecla pressionada na variavel da tela. */
+    /* processa eventos do servidor X, atualizando a posicao do mouse,
+     * as teclas apertadas e a fila de eventos de teclado. */
     ALLEGRO_EVENT event;
 
-    // al_wait_for_event(queue, &event);
-    while (al_get_next_event(queue, &event)) { 
-        switch (event.type) {
-        /* _tecla foi pressionada */
-        case ALLEGRO_EVENT_KEY_DOWN: {
-            /* const char* keyname = al_keycode_to_name(event.keyboard.keycode);
-            printf("code %d char '%c' name '%s' (q=%d)\n",
-            event.keyboard.keycode,
-              (char)event.keyboard.keycode, keyname, 'Q');*/
-            _tecla = event.keyboard.keycode;
-            break;
-        }
-        case ALLEGRO_EVENT_MOUSE_AXES: {
-            _rato.x = XX2U(event.mouse.x);
-            _rato.y = YX2U(event.mouse.y);
-            break;
-        }
-        case ALLEGRO_EVENT_MOUSE_BUTTON_DOWN: {
-            if (event.mouse.button == 1)
-                _botao = true;
-            break;
-        }
-        case ALLEGRO_EVENT_MOUSE_BUTTON_UP: {
-            if (event.mouse.button == 1)
-                _botao = false;
-            break;
-        }
-        case ALLEGRO_EVENT_TIMER: {
-            break;
-      
-
-      }
-    }
-  }
-}	  /* _botao de fechar janela pressionado 
-	  case ALLEGRO_EVENT_DISPLAY_CLOSE:
-		  {
-			  return;
-			  break;
-		  }
-#endif
-        default:
-            break;
-        }
+    while (al_get_next_event(queue, &event))
+        trata_evento(event);
+}
+
+void Tela::trata_evento(const ALLEGRO_EVENT &event) {
+    switch (event.type) {
+    /* tecla foi pressionada ou solta */
+    case ALLEGRO_EVENT_KEY_DOWN:
+    case ALLEGRO_EVENT_KEY_UP: {
+        int k = event.keyboard.keycode;
+        bool desce = event.type == ALLEGRO_EVENT_KEY_DOWN;
+        if (k >= 0 && k < ALLEGRO_KEY_MAX)
+            _teclas[k] = desce;
+        enfileira(_eventos, _ev_inicio, _ev_fim, _ev_perdidos,
+                  EventoTecla{k, desce, event.any.timestamp});
+        break;
+    }
+    case ALLEGRO_EVENT_MOUSE_AXES: {
+        _rato.x = XX2U(event.mouse.x);
+        _rato.y = YX2U(event.mouse.y);
+        break;
+    }
+    case ALLEGRO_EVENT_MOUSE_BUTTON_DOWN: {
+        if (event.mouse.button == 1)
+            _botao = true;
+        break;
+    }
+    case ALLEGRO_EVENT_MOUSE_BUTTON_UP: {
+        if (event.mouse.button == 1)
+            _botao = false;
+        break;
+    }
+    /* mais um passo do relogio para o jogo executar */
+    case ALLEGRO_EVENT_TIMER: {
+        _passos++;
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void Tela::relogio(double hz) {
+    timer = al_create_timer(1.0 / hz);
+    if (timer == NULL) {
+        std::cerr << "falha ao criar timer do allegro" << std::endl;
+        std::abort();
     }
+    al_register_event_source(queue, al_get_timer_event_source(timer));
+    _passos = 0;
+    al_start_timer(timer);
 }
-*/
+
+int Tela::espera_passos() {
+    /* dorme ate o relogio andar; os eventos que chegarem antes sao
+     * tratados no caminho */
+    ALLEGRO_EVENT event;
+    while (_passos == 0) {
+        al_wait_for_event(queue, &event);
+        trata_evento(event);
+    }
+    processa_eventos();
+    /* se atrasou demais, descarta passos em vez de tentar alcancar */
+    int n = std::min(_passos, TELA_PASSOS_MAX);
+    _passos = 0;
+    return n;
+}
+
+/* poe um triangulo de cor unica no lote */
+static void triangulo(std::vector<ALLEGRO_VERTEX>& lote, ALLEGRO_COLOR cor,
+                      float x0, float y0, float x1, float y1, float x2,
+                      float y2) {
+    lote.push_back(ALLEGRO_VERTEX{x0, y0, 0, 0, 0, cor});
+    lote.push_back(ALLEGRO_VERTEX{x1, y1, 0, 0, 0, cor});
+    lote.push_back(ALLEGRO_VERTEX{x2, y2, 0, 0, 0, cor});
+}
+
 void Tela::retangulo(Retangulo r) {
-    /* preenche o retangulo r com a cor padrao */
-    al_draw_filled_rectangle(
-        /* canto superior esquerdo */
-        XU2X(r.pos.x), YU2X(r.pos.y),
-        /* canto inferior direito */
-        XU2X(r.pos.x + r.tam.larg), YU2X(r.pos.y + r.tam.alt), ac_cor);
+    /* preenche o retangulo r com a cor padrao: dois triangulos */
+    float x0 = XU2X(r.pos.x), y0 = YU2X(r.pos.y);
+    float x1 = XU2X(r.pos.x + r.tam.larg), y1 = YU2X(r.pos.y + r.tam.alt);
+    if (sem_janela) {
+        quadro_retangulo(quadro, Retangulo{{x0, y0}, {x1 - x0, y1 - y0}}, _rgba);
+        return;
+    }
+    triangulo(_lote, ac_cor, x0, y0, x1, y0, x1, y1);
+    triangulo(_lote, ac_cor, x0, y0, x1, y1, x0, y1);
 }
 
 void Tela::circulo(Circulo c) {
-    /* preenche o circulo r na tela com a cor padrao */
-    al_draw_filled_circle(XU2X(c.centro.x), YU2X(c.centro.y), XU2X(c.raio),
-                          ac_cor);
+    /* preenche o circulo r na tela com a cor padrao: um leque de
+     * triangulos, com mais lados nos circulos grandes */
+    float cx = XU2X(c.centro.x), cy = YU2X(c.centro.y), r = XU2X(c.raio);
+    if (sem_janela) {
+        quadro_circulo(quadro, Circulo{{cx, cy}, r}, _rgba);
+        return;
+    }
+    int lados = std::clamp(int(2 * r), 8, 64);
+    float cs = std::cos(2 * M_PI / lados), sn = std::sin(2 * M_PI / lados);
+    float dx = r, dy = 0;
+    for (int k = 0; k < lados; k++) {
+        /* gira (dx, dy) de um lado */
+        float ex = dx * cs - dy * sn, ey = dx * sn + dy * cs;
+        triangulo(_lote, ac_cor, cx, cy, cx + dx, cy + dy, cx + ex, cy + ey);
+        dx = ex;
+        dy = ey;
+    }
 }
 
 void Tela::linha(Ponto p1, Ponto p2) {
-    /* une os dois pontos com uma linha na cor padrao */
-    al_draw_line(XU2X(p1.x), YU2X(p1.y), XU2X(p2.x), YU2X(p2.y), ac_cor, 0.0);
+    /* une os dois pontos com uma linha na cor padrao: um retangulo de um
+     * pixel de largura ao longo do segmento */
+    float x0 = XU2X(p1.x), y0 = YU2X(p1.y), x1 = XU2X(p2.x), y1 = YU2X(p2.y);
+    if (sem_janela) {
+        quadro_linha(quadro, Ponto{x0, y0}, Ponto{x1, y1}, _rgba);
+        return;
+    }
+    float d = std::hypot(x1 - x0, y1 - y0);
+    if (d == 0)
+        return;
+    float nx = -(y1 - y0) / d * 0.5f, ny = (x1 - x0) / d * 0.5f;
+    triangulo(_lote, ac_cor, x0 + nx, y0 + ny, x1 + nx, y1 + ny, x1 - nx, y1 - ny);
+    triangulo(_lote, ac_cor, x0 + nx, y0 + ny, x1 - nx, y1 - ny, x0 - nx, y0 - ny);
 }
 
 #define AJEITA(x) (x < 0 ? 0 : (x > 1 ? 1 : x))
 void Tela::cor(Cor c) {
-    /* altera a cor padrao */
+    /* altera a cor padrao; a mesma cor de novo nao precisa converter */
+    if (c.r == _ultima.r && c.g == _ultima.g && c.b == _ultima.b)
+        return;
+    _ultima = c;
+    _custo.conversoes++;
     int R, G, B;
     R = AJEITA(c.r) * ((1 << B_R) - 1);
     G = AJEITA(c.g) * ((1 << B_G) - 1);
     B = AJEITA(c.b) * ((1 << B_B) - 1);
     ac_cor = al_map_rgb(R, G, B);
+    _rgba = quadro_rgba(R, G, B);
+}
+
+int Tela::paleta(Cor c) {
+    /* converte direto: a cor atual e os contadores ficam como estao */
+    int R, G, B;
+    R = AJEITA(c.r) * ((1 << B_R) - 1);
+    G = AJEITA(c.g) * ((1 << B_G) - 1);
+    B = AJEITA(c.b) * ((1 << B_B) - 1);
+    _paleta.push_back(al_map_rgb(R, G, B));
+    _paleta_rgba.push_back(quadro_rgba(R, G, B));
+    return _paleta.size() - 1;
+}
+
+void Tela::cor(int indice) {
+    ac_cor = _paleta[indice];
+    _rgba = _paleta_rgba[indice];
+    /* a proxima cor(Cor) tem que converter */
+    _ultima = Cor{-1, -1, -1};
+    _custo.trocas++;
+}
+
+TelaCusto Tela::custo() const {
+    return _custo_quadro;
+}
+
+void Tela::captura(const char *nome) {
+    Quadro q;
+    if (sem_janela) {
+        q = quadro;
+        quadro_descorta(q);
+    } else {
+        /* le o bitmap na ordem do quadro: R, G, B, A na memoria */
+        ALLEGRO_LOCKED_REGION *r = al_lock_bitmap(
+            _alvo, ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_READONLY);
+        if (r == NULL) {
+            std::cerr << "falha ao ler a tela para " << nome << std::endl;
+            return;
+        }
+        quadro_inicia(q, tam.larg, tam.alt);
+        for (int y = 0; y < q.alt; y++)
+            std::memcpy(&q.px[size_t(y) * q.larg],
+                        (const char *)r->data + (long)y * r->pitch,
+                        size_t(q.larg) * 4);
+        al_unlock_bitmap(_alvo);
+    }
+    {
+        std::lock_guard<std::mutex> lk(_capturas_m);
+        _capturas.emplace_back(nome, std::move(q));
+    }
+    _capturas_cv.notify_all();
+    if (!_gravador.joinable())
+        _gravador = std::thread([this] { grava_capturas(); });
+}
+
+void Tela::espera_capturas() {
+    std::unique_lock<std::mutex> lk(_capturas_m);
+    _capturas_cv.wait(lk, [this] { return _capturas.empty() && !_gravando; });
+}
+
+void Tela::grava_capturas() {
+    std::unique_lock<std::mutex> lk(_capturas_m);
+    for (;;) {
+        _capturas_cv.wait(lk, [this] { return _fim_capturas || !_capturas.empty(); });
+        if (_capturas.empty())
+            return;
+        std::pair<std::string, Quadro> c = std::move(_capturas.front());
+        _capturas.pop_front();
+        _gravando = true;
+        /* grava sem segurar a fila */
+        lk.unlock();
+        if (!quadro_grava_ppm(c.second, c.first.c_str()))
+            std::cerr << "falha ao gravar " << c.first << std::endl;
+        lk.lock();
+        _gravando = false;
+        _capturas_cv.notify_all();
+    }
 }
 
 int Tela::strlen(const char *s) const {
+    if (sem_janela)
+        return quadro_largura_texto(_fonte_quadro, s);
     return al_get_text_width(fonte, s);
 }
 
 void Tela::texto(Ponto p, const char *s) {
+    /* o texto vai por cima do que ja foi pedido */
+    descarrega();
+    _custo.chamadas++;
+    if (sem_janela) {
+        quadro_texto(quadro, _fonte_quadro, Ponto{XU2X(p.x), YU2X(p.y)}, s, _rgba);
+        return;
+    }
     /* escreve o texto s na posicao p da tela */
     al_draw_text(fonte, ac_cor, XU2X(p.x), YU2X(p.y), ALLEGRO_ALIGN_LEFT, s);
     
 }
 
+void Tela::numero(Ponto p, int n) {
+    if (sem_janela) {
+        /* no quadro o texto ja e barato */
+        char s[12];
+        std::snprintf(s, sizeof s, "%d", n);
+        texto(p, s);
+        return;
+    }
+    /* as figuras pedidas antes ficam por baixo */
+    if (!_lote.empty())
+        descarrega();
+    if (!_segura) {
+        al_hold_bitmap_drawing(true);
+        _segura = true;
+    }
+    /* indices dos caracteres em _digitos, do ultimo para o primeiro */
+    int cs[12], nc = 0;
+    unsigned u = (n < 0) ? -(unsigned)n : n;
+    do {
+        cs[nc++] = 1 + u % 10;
+        u /= 10;
+    } while (u != 0);
+    if (n < 0)
+        cs[nc++] = 0;
+    float x = XU2X(p.x), y = YU2X(p.y);
+    float alt = al_get_bitmap_height(_digitos);
+    while (nc > 0) {
+        int k = cs[--nc];
+        al_draw_tinted_bitmap_region(_digitos, ac_cor, _digito_x[k], 0,
+                                     _digito_larg[k], alt, x, y, 0);
+        x += _digito_larg[k];
+    }
+}
+
 Ponto Tela::rato() {
     /* retorna a posicao do mouse */
     processa_eventos();
@@ -273,6 +695,11 @@ bool Tela::botao() {
 
 Tamanho Tela::tamanho_texto(const char *s) {
     Tamanho tam;
+    if (sem_janela) {
+        tam.larg = quadro_largura_texto(_fonte_quadro, s);
+        tam.alt = _fonte_quadro.alt;
+        return tam;
+    }
     int bbx, bby, bbw, bbh;
     al_get_text_dimensions(fonte, s, &bbx, &bby, &bbw, &bbh);
     tam.larg = bbw;
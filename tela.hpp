@@ -32,12 +32,39 @@
 #include <allegro5/allegro_color.h>
 #include <allegro5/allegro_primitives.h>
 
+#include <bitset>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
 #include "geom.hpp"
+#include "quadro.hpp"
 
 using namespace geom;
 
 namespace tela {
 
+// passos do relogio devolvidos de uma vez por espera_passos; o resto de um
+// atraso maior e descartado
+const int TELA_PASSOS_MAX = 5;
+
+// regioes sujas guardadas por quadro; alem disso, sao juntadas
+const int TELA_SUJOS = 4;
+
+// capacidade da fila de eventos de teclado (potencia de 2)
+const int TELA_EVENTOS = 256;
+
+// tecla apertada (desce) ou solta, e quando (segundos do relogio do allegro)
+struct EventoTecla {
+    int tecla;
+    bool desce;
+    double quando;
+};
+
 // estrutura que representa uma cor, com os componentes
 // vermelho, verde e azul podendo variar entre 0 e 1.
 struct Cor {
@@ -46,6 +73,15 @@ struct Cor {
     float b;
 };
 
+// custo do desenho em um quadro (ver Tela::custo)
+struct TelaCusto {
+    long conversoes; // Cor convertida em ALLEGRO_COLOR
+    long trocas;     // trocas de cor pela paleta
+    long chamadas;   // chamadas de desenho ao allegro
+    long vertices;   // vertices enviados nos lotes
+    double ms;       // tempo de limpa ate mostra, sem a troca de buffers
+};
+
 // define uma tela
 struct Tela {
     ALLEGRO_DISPLAY *display;   // display X
@@ -53,12 +89,47 @@ struct Tela {
     ALLEGRO_COLOR ac_cor;       // cor padrao
     ALLEGRO_EVENT_QUEUE *queue; // fila de eventos
     ALLEGRO_FONT *fonte;        // fonte padrao
-    /* ALLEGRO_TIMER *timer;  // timer */
+    ALLEGRO_TIMER *timer;       // relogio dos passos do jogo
     Retangulo janela; // retangulo que contem nossa janela
     Tamanho tam;      // tamanho da janela
     Ponto _rato;      // onde esta o mouse
     bool _botao;      // estado do botao do mouse
-    int _tecla;       // ultima tecla apertada
+    std::bitset<ALLEGRO_KEY_MAX> _teclas;   // teclas apertadas agora
+    EventoTecla _eventos[TELA_EVENTOS];     // fila circular de eventos
+    unsigned _ev_inicio, _ev_fim;           // contadores da fila
+    long _ev_perdidos;                      // descartados com a fila cheia
+    int _passos;      // passos do relogio ainda nao devolvidos
+    std::vector<ALLEGRO_VERTEX> _lote; // triangulos ainda nao desenhados
+    ALLEGRO_BITMAP *_digitos;   // "-0123456789" ja desenhados, em branco
+    int _digito_x[11];          // inicio de cada caractere em _digitos
+    int _digito_larg[11];       // largura de cada caractere
+    bool _segura;               // numeros seguros no lote do allegro
+    std::vector<ALLEGRO_COLOR> _paleta; // cores ja convertidas
+    Cor _ultima;                // ultima cor convertida por cor(Cor)
+    TelaCusto _custo;           // custo do quadro sendo desenhado
+    TelaCusto _custo_quadro;    // custo do ultimo quadro mostrado
+    double _inicio_quadro;      // quando limpa foi chamada
+    ALLEGRO_BITMAP *_alvo;      // onde se desenha; mostra copia para a janela
+    std::vector<Retangulo> _sujos; // regioes a redesenhar, em pixels inteiros
+    std::vector<Retangulo> _mostrados; // sujos do quadro anterior
+    int _regiao;                // regiao de limpa_regiao, ou -1 (tela toda)
+
+    // Sem janela (sem servidor X ou com a variavel de ambiente
+    // TELA_SEM_JANELA) tudo e desenhado por software em 'quadro'.
+    bool sem_janela;
+    Quadro quadro;              // pixels da tela quando sem_janela
+    Fonte _fonte_quadro;        // fonte para desenhar no quadro
+    uint32_t _rgba;             // cor padrao no formato do quadro
+    uint32_t _rgba_fundo;       // cor de fundo no formato do quadro
+    std::vector<uint32_t> _paleta_rgba; // paleta no formato do quadro
+
+    // capturas copiadas e ainda nao gravadas, e a thread que as grava
+    std::deque<std::pair<std::string, Quadro>> _capturas;
+    bool _gravando;             // uma captura saiu da fila e esta sendo gravada
+    bool _fim_capturas;         // finaliza pediu para a thread terminar
+    std::mutex _capturas_m;
+    std::condition_variable _capturas_cv;
+    std::thread _gravador;
 
     // inicializa a tela; deve ser chamada no inicio da execucao do programa
     void inicia(int larg, int alt, const char *nome);
@@ -72,27 +143,84 @@ struct Tela {
     // faz aparecer na janela o que foi desenhado
     void mostra();
 
+    // Redesenho parcial: o que muda chama suja() com a caixa onde estava e
+    // com a caixa onde esta. A imagem do quadro anterior fica guardada, e
+    // so as regioes sujas sao refeitas: para cada i < sujos(),
+    // limpa_regiao(i) limpa a regiao i e corta os desenhos seguintes a ela
+    // (al_set_clipping_rectangle), e o que toca a regiao e desenhado de
+    // novo. Regioes que se tocam viram uma so. mostra copia para a janela
+    // so as regioes sujas e esvazia a lista.
+    void suja(Retangulo r);
+    void suja_tudo();
+    int sujos() const;
+    void limpa_regiao(int i);
+
+    // true se r toca a regiao da ultima limpa_regiao (sempre true depois de
+    // limpa ou mostra); o que nao toca nao precisa ser desenhado
+    bool visivel(Retangulo r) const;
+
     // muda a cor dos proximos desenhos de linha/retangulo/caracteres/etc
     void cor(Cor c);
 
+    // converte c uma vez e retorna seu indice na paleta; cor(indice) so
+    // copia a cor convertida. Como a cor vai em cada vertice do lote, trocar
+    // de cor nao interrompe o lote. Nao muda a cor atual nem o custo.
+    int paleta(Cor c);
+    void cor(int indice);
+
+    // custo do ultimo quadro mostrado
+    TelaCusto custo() const;
+
+    // Copia o que foi mostrado (o quadro em memoria, ou o bitmap que vai
+    // para a janela) e grava em um PPM de nome 'nome'. A gravacao fica
+    // para outra thread; so a copia e feita aqui, entao deve ser chamada
+    // pela thread que desenha, depois de mostra. Para comparar capturas,
+    // ver compara.cpp.
+    void captura(const char *nome);
+
+    // espera todas as capturas pedidas serem gravadas
+    void espera_capturas();
+
+    // laco da thread que grava as capturas
+    void grava_capturas();
+
     // calcula o numero de pixels (horizontais) necessarios a string s
     int strlen(const char *s) const;
 
     // escreve o texto s a partir da posicao p da tela
     void texto(Ponto p, const char *s);
 
+    // Escreve o inteiro n a partir da posicao p, como texto(p, "n"), mas
+    // copiando os digitos de um bitmap feito em inicia. Numeros seguidos
+    // sao desenhados juntos, em uma so chamada.
+    void numero(Ponto p, int n);
+
     // retorna o codigo da proxima tecla apertada (ou 0, se nao tiver tecla
-    // alguma)
+    // alguma); as teclas soltas no caminho sao descartadas
     int tecla();
 
+    // Os eventos de teclado vao para uma fila circular de tamanho fixo, na
+    // ordem em que chegaram. proximo_evento tira o mais antigo e retorna
+    // false com a fila vazia; o jogo esvazia a fila a cada passo. Se a fila
+    // encher, os mais antigos sao descartados (contados em _ev_perdidos).
+    bool proximo_evento(EventoTecla &e);
+
+    // true enquanto a tecla estiver apertada
+    bool apertada(int tecla) const;
+
     // retorna true se o botao do mouse estiver apertado
     bool botao();
 
     // retorna a posicao do cursor do mouse
     Ponto rato();
 
-    // tempo de espera da tela, em microsegundos
-    void espera(double ms);
+    // liga o relogio com hz passos por segundo
+    void relogio(double hz);
+
+    // Bloqueia ate o relogio dar pelo menos um passo e retorna quantos
+    // passos deu desde a ultima chamada (no maximo TELA_PASSOS_MAX). Os
+    // eventos de teclado e mouse sao tratados enquanto espera.
+    int espera_passos();
 
     // desenha uma linha do ponto p1 ao ponto p2
     void linha(Ponto p1, Ponto p2);
@@ -103,14 +231,33 @@ struct Tela {
     // desenha um circulo
     void circulo(Circulo c);
 
+    // Linhas, retangulos e circulos nao sao desenhados na hora: viram
+    // triangulos (com a cor em cada vertice) em um lote, desenhado com uma
+    // so chamada. mostra, texto e numero descarregam o lote antes de
+    // continuar.
+    void descarrega();
+
     // tamanho necessario para se escrever o texto s
     Tamanho tamanho_texto(const char *s);
 
     // Tamanho da tela.
     Tamanho tamanho() const;
 
+    // O contexto do allegro e de uma thread por vez: a thread que vai
+    // deixar de desenhar chama solta(), e a que vai desenhar, assume().
+    // Eventos (tecla, rato, espera_passos) podem ficar em outra thread,
+    // desde que uma so.
+    void assume();
+    void solta();
+
     // processa eventos da tela
     void processa_eventos();
+
+    // atualiza o estado da tela com um evento
+    void trata_evento(const ALLEGRO_EVENT &event);
+
+    // monta o bitmap usado por numero
+    void inicia_digitos();
 };
 
 }; // namespace tela
@@ -0,0 +1,118 @@
+// tempo.hpp
+// Histogramas de duracoes (passo, desenho, quadro) que qualquer thread
+// anota e le sem travas, com percentis aproximados.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2023 João Vicente Ferreira Lima, UFSM
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+namespace tempo {
+
+// segundos de um relogio monotono
+inline double agora() {
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Faixas em microssegundos: ate 16 us, uma por microssegundo; depois, 8
+// por potencia de 2, ate 2^32 us. O erro dos percentis e de no maximo 1/8.
+const int HISTOGRAMA_FAIXAS = 16 + 28 * 8;
+
+// Cada anotacao so faz somas atomicas relaxadas, entao o jogo pode anotar
+// em uma thread enquanto a outra le. Uma leitura no meio de uma anotacao
+// pode ver a faixa sem o total, o que nao importa para os percentis.
+struct Histograma {
+    std::atomic<uint32_t> faixas[HISTOGRAMA_FAIXAS];
+    std::atomic<uint32_t> n{0};
+    std::atomic<uint32_t> max{0}; // em microssegundos
+};
+
+inline int histograma_faixa(uint32_t us) {
+    if(us < 16)
+        return us;
+    int e = std::bit_width(us) - 1;
+    return 16 + (e - 4) * 8 + ((us >> (e - 3)) & 7);
+}
+
+// menor duracao da faixa k, em microssegundos
+inline uint64_t histograma_inicio(int k) {
+    if(k < 16)
+        return k;
+    int e = (k - 16) / 8 + 4;
+    return uint64_t(8 + (k - 16) % 8) << (e - 3);
+}
+
+// anota uma duracao em segundos
+inline void histograma_anota(Histograma& h, double segundos) {
+    double us = segundos * 1e6;
+    uint32_t u = (us <= 0) ? 0 : (us >= 4294967295.0) ? 4294967295u : uint32_t(us);
+    h.faixas[histograma_faixa(u)].fetch_add(1, std::memory_order_relaxed);
+    h.n.fetch_add(1, std::memory_order_relaxed);
+    uint32_t m = h.max.load(std::memory_order_relaxed);
+    while(u > m && !h.max.compare_exchange_weak(m, u, std::memory_order_relaxed))
+        ;
+}
+
+// duracao, em milissegundos, abaixo da qual ficam a fracao p (0 a 1) das
+// anotacoes: o meio da faixa onde cai, limitado pelo maximo
+inline double histograma_percentil(const Histograma& h, double p) {
+    uint64_t total = 0;
+    for(int k = 0; k < HISTOGRAMA_FAIXAS; k++)
+        total += h.faixas[k].load(std::memory_order_relaxed);
+    if(total == 0)
+        return 0;
+    uint64_t alvo = (uint64_t)(p * total + 0.5);
+    if(alvo < 1)
+        alvo = 1;
+    uint64_t soma = 0;
+    int k = 0;
+    for(; k < HISTOGRAMA_FAIXAS - 1; k++) {
+        soma += h.faixas[k].load(std::memory_order_relaxed);
+        if(soma >= alvo)
+            break;
+    }
+    uint64_t meio = (k < 16) ? k : (histograma_inicio(k) + histograma_inicio(k + 1)) / 2;
+    uint64_t max = h.max.load(std::memory_order_relaxed);
+    return (meio < max ? meio : max) / 1e3;
+}
+
+inline double histograma_max(const Histograma& h) {
+    return h.max.load(std::memory_order_relaxed) / 1e3;
+}
+
+inline void histograma_mostra(std::ostream& os, const char* rotulo, const Histograma& h) {
+    os << "[tempo " << rotulo << "] n " << h.n.load(std::memory_order_relaxed)
+       << " | p50 " << histograma_percentil(h, 0.50)
+       << " | p95 " << histograma_percentil(h, 0.95)
+       << " | p99 " << histograma_percentil(h, 0.99)
+       << " | max " << histograma_max(h) << " ms" << std::endl;
+}
+
+}; // namespace tempo
@@ -0,0 +1,197 @@
+// varredura.hpp
+// Varredura e poda (sweep and prune) com coerencia temporal: mantem os
+// extremos das caixas ordenados nos eixos x e y entre um quadro e outro e
+// informa os pares de retangulos que passaram a se tocar ou deixaram de se
+// tocar.
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2023 João Vicente Ferreira Lima, UFSM
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "geom.hpp"
+
+namespace geom {
+
+// Cada caixa tem dois extremos (inicio e fim) em cada eixo. Quando dois
+// extremos vizinhos trocam de lugar na ordenacao, so o par das duas caixas
+// pode mudar: um inicio que passa para antes de um fim liga a sobreposicao
+// naquele eixo, um fim que passa para antes de um inicio desliga. O par se
+// toca quando ha sobreposicao nos dois eixos.
+//
+// Como a formacao anda junta, a ordem quase nao muda entre quadros e a
+// ordenacao por insercao custa O(n + trocas).
+struct Varredura {
+    struct Extremo {
+        float v;
+        int id;
+        bool fim;
+    };
+
+    // o par (a, b) passou a se tocar (novo) ou deixou de se tocar
+    struct Evento {
+        int a, b;
+        bool novo;
+    };
+
+    std::vector<Extremo> eixo[2];           // extremos em x e em y, ordenados
+    std::vector<Retangulo> caixas;          // caixa de cada id
+    std::vector<bool> ativo;
+    std::vector<int> livres;                // ids para reaproveitar
+    std::unordered_map<uint64_t, int> eixos; // par -> eixos com sobreposicao
+    std::unordered_set<uint64_t> pares;     // pares que se tocam
+
+    // mudancas, na ordem em que ocorreram, desde a ultima chamada de
+    // varredura_limpa_eventos; um par pode aparecer e sumir no mesmo quadro
+    std::vector<Evento> eventos;
+};
+
+inline uint64_t varredura_chave(int a, int b) {
+    if (a > b)
+        std::swap(a, b);
+    return (uint64_t(uint32_t(a)) << 32) | uint32_t(b);
+}
+
+inline Varredura::Evento varredura_evento(uint64_t k, bool novo) {
+    return {int(k >> 32), int(k & 0xffffffffu), novo};
+}
+
+// o extremo b passou para antes do extremo a
+inline void varredura_troca(Varredura& s, const Varredura::Extremo& a,
+                            const Varredura::Extremo& b) {
+    if (a.fim == b.fim || a.id == b.id)
+        return;
+    uint64_t k = varredura_chave(a.id, b.id);
+    if (!b.fim) {
+        // inicio antes de um fim: passam a se sobrepor neste eixo
+        if (++s.eixos[k] == 2) {
+            s.pares.insert(k);
+            s.eventos.push_back(varredura_evento(k, true));
+        }
+    } else {
+        auto it = s.eixos.find(k);
+        if (it == s.eixos.end())
+            return;
+        if (it->second-- == 2) {
+            s.pares.erase(k);
+            s.eventos.push_back(varredura_evento(k, false));
+        }
+        if (it->second == 0)
+            s.eixos.erase(it);
+    }
+}
+
+inline float varredura_valor(const Retangulo& r, int e, bool fim) {
+    if (e == 0)
+        return fim ? r.pos.x + r.tam.larg : r.pos.x;
+    return fim ? r.pos.y + r.tam.alt : r.pos.y;
+}
+
+// ordem dos extremos: no mesmo valor, os fins vem antes dos inicios, para
+// caixas que so encostam nao contarem como sobrepostas (como em interrr),
+// qualquer que seja a ordem de insercao
+inline bool varredura_antes(const Varredura::Extremo& a, const Varredura::Extremo& b) {
+    return a.v < b.v || (a.v == b.v && a.fim && !b.fim);
+}
+
+// reordena os eixos por insercao, aplicando as trocas
+inline void varredura_atualiza(Varredura& s) {
+    for (int e = 0; e < 2; e++) {
+        std::vector<Varredura::Extremo>& ex = s.eixo[e];
+        for (Varredura::Extremo& x : ex)
+            x.v = varredura_valor(s.caixas[x.id], e, x.fim);
+        for (size_t i = 1; i < ex.size(); i++) {
+            Varredura::Extremo b = ex[i];
+            size_t j = i;
+            while (j > 0 && varredura_antes(b, ex[j - 1])) {
+                varredura_troca(s, ex[j - 1], b);
+                ex[j] = ex[j - 1];
+                j--;
+            }
+            ex[j] = b;
+        }
+    }
+}
+
+// insere uma caixa e retorna seu id; os pares aparecem no proximo
+// varredura_atualiza
+inline int varredura_insere(Varredura& s, Retangulo r) {
+    int id;
+    if (!s.livres.empty()) {
+        id = s.livres.back();
+        s.livres.pop_back();
+        s.caixas[id] = r;
+        s.ativo[id] = true;
+    } else {
+        id = s.caixas.size();
+        s.caixas.push_back(r);
+        s.ativo.push_back(true);
+    }
+    // entra no fim da ordem e a ordenacao o leva para o lugar certo
+    const float inf = std::numeric_limits<float>::infinity();
+    for (int e = 0; e < 2; e++) {
+        s.eixo[e].push_back({inf, id, false});
+        s.eixo[e].push_back({inf, id, true});
+    }
+    return id;
+}
+
+inline void varredura_move(Varredura& s, int id, Retangulo r) {
+    s.caixas[id] = r;
+}
+
+// remove a caixa id, desfazendo seus pares imediatamente: um evento de
+// saida por par que se tocava e nenhum outro
+inline void varredura_remove(Varredura& s, int id) {
+    // cada caixa tem um so inicio em x, entao cada outro id aparece uma vez
+    for (const Varredura::Extremo& x : s.eixo[0]) {
+        if (x.fim || x.id == id)
+            continue;
+        uint64_t k = varredura_chave(id, x.id);
+        s.eixos.erase(k);
+        if (s.pares.erase(k))
+            s.eventos.push_back(varredura_evento(k, false));
+    }
+    for (int e = 0; e < 2; e++) {
+        std::vector<Varredura::Extremo>& ex = s.eixo[e];
+        ex.erase(std::remove_if(ex.begin(), ex.end(),
+                                [id](const Varredura::Extremo& x) { return x.id == id; }),
+                 ex.end());
+    }
+    s.ativo[id] = false;
+    s.livres.push_back(id);
+}
+
+inline void varredura_limpa_eventos(Varredura& s) {
+    s.eventos.clear();
+}
+
+}; // namespace geom